@@ -39,17 +39,19 @@
  * BSD Licensed as described in the file LICENSE
  */
 #include "dht.h"
+#include "dht_private.h"
 
 #include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
 #include <string.h>
+#include <inttypes.h>
 #include <esp_log.h>
 #include <ets_sys.h>
 #include <esp_idf_lib_helpers.h>
 
 // DHT timer precision in microseconds
 #define DHT_TIMER_INTERVAL 2
-#define DHT_DATA_BITS 40
-#define DHT_DATA_BYTES (DHT_DATA_BITS / 8)
 
 /*
  *  Note:
@@ -62,7 +64,9 @@
  *
  *  Initializing communications with the DHT requires four 'phases' as follows:
  *
- *  Phase A - MCU pulls signal low for at least 18000 us
+ *  Phase A - MCU pulls signal low for at least 18000 us. This phase is not
+ *            timing-critical and is done with a task delay, outside of the
+ *            critical section.
  *  Phase B - MCU allows signal to float back up and waits 20-40us for DHT to pull it low
  *  Phase C - DHT pulls signal low for ~80us
  *  Phase D - DHT lets signal float back up for ~80us
@@ -81,6 +85,8 @@
 
 static const char *TAG = "dht";
 
+static dht_critical_stats_t critical_stats = { 0 };
+
 #if HELPER_TARGET_IS_ESP32
 static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
 #define PORT_ENTER_CRITICAL() portENTER_CRITICAL(&mux)
@@ -91,8 +97,6 @@ static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
 #define PORT_EXIT_CRITICAL() portEXIT_CRITICAL()
 #endif
 
-#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
-
 #define CHECK_LOGE(x, msg, ...) do { \
         esp_err_t __; \
         if ((__ = x) != ESP_OK) { \
@@ -133,7 +137,7 @@ static esp_err_t dht_await_pin_state(gpio_num_t pin, uint32_t timeout,
 }
 
 /**
- * Request data from DHT and read raw bit stream.
+ * Release the line after the phase 'A' start pulse and read raw bit stream.
  * The function call should be protected from task switching.
  * Return false if error occurred.
  */
@@ -142,10 +146,7 @@ static inline esp_err_t dht_fetch_data(dht_sensor_type_t sensor_type, gpio_num_t
     uint32_t low_duration;
     uint32_t high_duration;
 
-    // Phase 'A' pulling signal low to initiate read sequence
-    gpio_set_direction(pin, GPIO_MODE_OUTPUT_OD);
-    gpio_set_level(pin, 0);
-    ets_delay_us(sensor_type == DHT_TYPE_SI7021 ? 500 : 20000);
+    // End of phase 'A', let the line float up
     gpio_set_level(pin, 1);
 
     // Step through Phase 'B', 40us
@@ -200,20 +201,71 @@ static inline int16_t dht_convert_data(dht_sensor_type_t sensor_type, uint8_t ms
     return data;
 }
 
+esp_err_t dht_decode_data(dht_sensor_type_t sensor_type, const uint8_t data[DHT_DATA_BYTES],
+        int16_t *humidity, int16_t *temperature)
+{
+    if (data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF))
+    {
+        ESP_LOGE(TAG, "Checksum failed, invalid data received from sensor");
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    if (humidity)
+        *humidity = dht_convert_data(sensor_type, data[0], data[1]);
+    if (temperature)
+        *temperature = dht_convert_data(sensor_type, data[2], data[3]);
+
+    ESP_LOGD(TAG, "Sensor data: humidity=%d, temp=%d", *humidity, *temperature);
+
+    return ESP_OK;
+}
+
 esp_err_t dht_read_data(dht_sensor_type_t sensor_type, gpio_num_t pin,
         int16_t *humidity, int16_t *temperature)
 {
     CHECK_ARG(humidity || temperature);
 
+#if HELPER_TARGET_IS_ESP32
+    // Pins with an RMT capture backend never busy-wait
+    dht_rmt_handle_t rmt = dht_rmt_find(pin);
+    if (rmt)
+    {
+        esp_err_t res = dht_rmt_start(rmt, sensor_type);
+        if (res != ESP_OK)
+            return res;
+        return dht_rmt_get_data(rmt, sensor_type, pdMS_TO_TICKS(DHT_RMT_READ_TIMEOUT_MS),
+                humidity, temperature);
+    }
+#endif
+
     uint8_t data[DHT_DATA_BYTES] = { 0 };
 
     gpio_set_direction(pin, GPIO_MODE_OUTPUT_OD);
     gpio_set_level(pin, 1);
 
+    // Phase 'A' pulling signal low to initiate read sequence. The sensor
+    // only needs the line held low, so sleep rather than spin with
+    // interrupts disabled. One extra tick guarantees the minimum length.
+    gpio_set_level(pin, 0);
+    if (sensor_type == DHT_TYPE_SI7021)
+        ets_delay_us(DHT_SI7021_START_PULSE_US);
+    else
+        vTaskDelay(pdMS_TO_TICKS(DHT_START_PULSE_MS) + 1);
+
+    // Only the ~4 ms response and bit stream are timing-critical
+    int64_t critical_start = esp_timer_get_time();
     PORT_ENTER_CRITICAL();
     esp_err_t result = dht_fetch_data(sensor_type, pin, data);
     if (result == ESP_OK)
         PORT_EXIT_CRITICAL();
+    uint32_t critical_us = (uint32_t)(esp_timer_get_time() - critical_start);
+
+    critical_stats.last_us = critical_us;
+    if (critical_us > critical_stats.max_us)
+        critical_stats.max_us = critical_us;
+    critical_stats.reads++;
+    ESP_LOGD(TAG, "Interrupts disabled for %" PRIu32 " us (worst %" PRIu32 " us)",
+            critical_us, critical_stats.max_us);
 
     /* restore GPIO direction because, after calling dht_fetch_data(), the
      * GPIO direction mode changes */
@@ -223,20 +275,7 @@ esp_err_t dht_read_data(dht_sensor_type_t sensor_type, gpio_num_t pin,
     if (result != ESP_OK)
         return result;
 
-    if (data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF))
-    {
-        ESP_LOGE(TAG, "Checksum failed, invalid data received from sensor");
-        return ESP_ERR_INVALID_CRC;
-    }
-
-    if (humidity)
-        *humidity = dht_convert_data(sensor_type, data[0], data[1]);
-    if (temperature)
-        *temperature = dht_convert_data(sensor_type, data[2], data[3]);
-
-    ESP_LOGD(TAG, "Sensor data: humidity=%d, temp=%d", *humidity, *temperature);
-
-    return ESP_OK;
+    return dht_decode_data(sensor_type, data, humidity, temperature);
 }
 
 esp_err_t dht_read_float_data(dht_sensor_type_t sensor_type, gpio_num_t pin,
@@ -257,3 +296,14 @@ esp_err_t dht_read_float_data(dht_sensor_type_t sensor_type, gpio_num_t pin,
 
     return ESP_OK;
 }
+
+void dht_get_critical_stats(dht_critical_stats_t *stats)
+{
+    if (stats)
+        *stats = critical_stats;
+}
+
+void dht_reset_critical_stats(void)
+{
+    memset(&critical_stats, 0, sizeof(critical_stats));
+}
@@ -48,6 +48,7 @@
 
 #include <driver/gpio.h>
 #include <esp_err.h>
+#include <freertos/FreeRTOS.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -63,12 +64,31 @@ typedef enum
     DHT_TYPE_SI7021       //!< Itead Si7021
 } dht_sensor_type_t;
 
+/**
+ * Handle of an RMT capture backend bound to one GPIO
+ */
+typedef struct dht_rmt_t *dht_rmt_handle_t;
+
+/**
+ * Interrupts-disabled time per read, measured around the timing-critical
+ * part of the transfer
+ */
+typedef struct
+{
+    uint32_t last_us;     //!< Critical section length of the most recent read
+    uint32_t max_us;      //!< Worst case since boot or the last reset
+    uint32_t reads;       //!< Number of reads measured
+} dht_critical_stats_t;
+
 /**
  * @brief Read integer data from sensor on specified pin
  *
  * Humidity and temperature are returned as integers.
  * For example: humidity=625 is 62.5 %, temperature=244 is 24.4 degrees Celsius
  *
+ * Blocks the calling task for the ~20 ms start pulse, so it must be called
+ * from a task and not from a critical section.
+ *
  * @param sensor_type DHT11 or DHT22
  * @param pin GPIO pin connected to sensor OUT
  * @param[out] humidity Humidity, percents * 10, nullable
@@ -92,6 +112,70 @@ esp_err_t dht_read_data(dht_sensor_type_t sensor_type, gpio_num_t pin,
 esp_err_t dht_read_float_data(dht_sensor_type_t sensor_type, gpio_num_t pin,
         float *humidity, float *temperature);
 
+/**
+ * @brief Get interrupts-disabled time statistics
+ *
+ * @param[out] stats Statistics since boot or the last reset
+ */
+void dht_get_critical_stats(dht_critical_stats_t *stats);
+
+/**
+ * @brief Reset interrupts-disabled time statistics
+ */
+void dht_reset_critical_stats(void);
+
+/**
+ * @brief Create an RMT capture backend for a pin
+ *
+ * Once created, dht_read_data() and dht_read_float_data() on this pin use
+ * the RMT backend transparently: the pulse train is recorded in hardware and
+ * decoded from pulse widths afterwards, with no busy-waiting and no critical
+ * section. Not available on ESP8266.
+ *
+ * @param pin GPIO pin connected to sensor OUT
+ * @param[out] ret_handle Created backend
+ * @return `ESP_OK` on success
+ */
+esp_err_t dht_rmt_new(gpio_num_t pin, dht_rmt_handle_t *ret_handle);
+
+/**
+ * @brief Delete an RMT capture backend, the pin falls back to bit-banging
+ *
+ * @param handle Backend handle
+ * @return `ESP_OK` on success
+ */
+esp_err_t dht_rmt_del(dht_rmt_handle_t handle);
+
+/**
+ * @brief Start an asynchronous read
+ *
+ * Drives the start pulse and returns immediately. The start pulse is ended
+ * by a timer, after which the RMT peripheral captures the transfer. Collect
+ * the result with dht_rmt_get_data().
+ *
+ * The RMT channel, and the power management lock it holds, is only enabled
+ * from here until dht_rmt_get_data() returns a result or times out.
+ *
+ * @param handle Backend handle
+ * @param sensor_type DHT11 or DHT22
+ * @return `ESP_OK` on success
+ */
+esp_err_t dht_rmt_start(dht_rmt_handle_t handle, dht_sensor_type_t sensor_type);
+
+/**
+ * @brief Get the result of an asynchronous read
+ *
+ * @param handle Backend handle
+ * @param sensor_type DHT11 or DHT22
+ * @param timeout Ticks to wait for the transfer, 0 to poll
+ * @param[out] humidity Humidity, percents * 10, nullable
+ * @param[out] temperature Temperature, degrees Celsius * 10, nullable
+ * @return `ESP_OK` on success, `ESP_ERR_NOT_FINISHED` if polling and the
+ *         transfer is still running, `ESP_ERR_TIMEOUT` if the sensor did not answer
+ */
+esp_err_t dht_rmt_get_data(dht_rmt_handle_t handle, dht_sensor_type_t sensor_type, TickType_t timeout,
+        int16_t *humidity, int16_t *temperature);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,37 @@
+/**
+ * @file dht_private.h
+ *
+ * Definitions shared between the bit-banged and RMT DHT backends
+ */
+#ifndef __DHT_PRIVATE_H__
+#define __DHT_PRIVATE_H__
+
+#include <stdint.h>
+#include "dht.h"
+
+#define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
+
+#define DHT_DATA_BITS 40
+#define DHT_DATA_BYTES (DHT_DATA_BITS / 8)
+
+// Phase 'A' start pulse length for DHT11/AM2301, datasheet minimum is 18 ms
+#define DHT_START_PULSE_MS 20
+// Phase 'A' start pulse length for Si7021
+#define DHT_SI7021_START_PULSE_US 500
+
+// Longest a blocking read waits for the RMT backend, start pulse included
+#define DHT_RMT_READ_TIMEOUT_MS 50
+
+/**
+ * Verify the checksum of a raw 5-byte frame and convert it to
+ * humidity/temperature * 10
+ */
+esp_err_t dht_decode_data(dht_sensor_type_t sensor_type, const uint8_t data[DHT_DATA_BYTES],
+        int16_t *humidity, int16_t *temperature);
+
+/**
+ * Look up the RMT backend registered for a pin, NULL if there is none
+ */
+dht_rmt_handle_t dht_rmt_find(gpio_num_t pin);
+
+#endif  // __DHT_PRIVATE_H__
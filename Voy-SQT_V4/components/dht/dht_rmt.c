@@ -0,0 +1,297 @@
+/**
+ * @file dht_rmt.c
+ *
+ * DHT backend that captures the sensor's pulse train with the RMT RX
+ * peripheral and decodes it from the recorded pulse widths afterwards.
+ *
+ * The start pulse is ended by an esp_timer callback, which also arms the
+ * receiver. The RMT then records the whole 4-5 ms transfer in hardware and
+ * raises a single interrupt once the line has been idle for
+ * DHT_RMT_IDLE_NS. The CPU is free for the entire transfer.
+ *
+ * BSD Licensed as described in the file LICENSE
+ */
+#include "dht.h"
+#include "dht_private.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <string.h>
+#include <stdlib.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <driver/rmt_rx.h>
+
+// 1 us per RMT tick
+#define DHT_RMT_RESOLUTION_HZ 1000000
+// Pulses shorter than this are glitches (ESP32 filter maximum is ~3 us)
+#define DHT_RMT_GLITCH_NS 1000
+// Longest valid pulse is the ~80 us response, anything longer ends the frame
+#define DHT_RMT_IDLE_NS 200000
+// Response + 40 bits + end pulse fit comfortably in one memory block
+#define DHT_RMT_MEM_SYMBOLS 64
+#define DHT_RMT_MAX_HANDLES 2
+
+static const char *TAG = "dht_rmt";
+
+typedef struct
+{
+    esp_err_t result;
+    uint8_t data[DHT_DATA_BYTES];
+} dht_rmt_result_t;
+
+struct dht_rmt_t
+{
+    gpio_num_t pin;
+    rmt_channel_handle_t channel;
+    esp_timer_handle_t start_timer;
+    QueueHandle_t results;
+    bool enabled;
+    rmt_symbol_word_t symbols[DHT_RMT_MEM_SYMBOLS];
+};
+
+static dht_rmt_handle_t handles[DHT_RMT_MAX_HANDLES] = { 0 };
+
+static const rmt_receive_config_t receive_config = {
+    .signal_range_min_ns = DHT_RMT_GLITCH_NS,
+    .signal_range_max_ns = DHT_RMT_IDLE_NS,
+};
+
+/**
+ * Decode captured symbols into 5 raw bytes.
+ * Each data bit is a ~50 us low followed by a high whose length encodes
+ * the bit, so the last 40 complete low/high pairs are the payload.
+ */
+static esp_err_t IRAM_ATTR dht_rmt_decode(const rmt_symbol_word_t *symbols, size_t num_symbols,
+        uint8_t data[DHT_DATA_BYTES])
+{
+    uint64_t bits = 0;
+    size_t pairs = 0;
+    uint16_t low = 0;
+
+    // Walk the pulses in order, shifting in one bit per low/high pair
+    for (size_t i = 0; i < num_symbols; i++)
+    {
+        uint16_t durations[2] = { symbols[i].duration0, symbols[i].duration1 };
+        uint16_t levels[2] = { symbols[i].level0, symbols[i].level1 };
+        for (int j = 0; j < 2; j++)
+        {
+            if (durations[j] == 0)
+                continue;
+            if (levels[j] == 0)
+                low = durations[j];
+            else if (low)
+            {
+                bits = (bits << 1) | (durations[j] > low);
+                pairs++;
+                low = 0;
+            }
+        }
+    }
+
+    if (pairs < DHT_DATA_BITS)
+        return ESP_ERR_INVALID_RESPONSE;
+
+    for (int i = 0; i < DHT_DATA_BYTES; i++)
+        data[i] = (bits >> (8 * (DHT_DATA_BYTES - 1 - i))) & 0xFF;
+
+    return ESP_OK;
+}
+
+static bool IRAM_ATTR dht_rmt_on_recv_done(rmt_channel_handle_t channel,
+        const rmt_rx_done_event_data_t *edata, void *user_ctx)
+{
+    dht_rmt_handle_t handle = (dht_rmt_handle_t)user_ctx;
+    dht_rmt_result_t res;
+    BaseType_t woken = pdFALSE;
+
+    res.result = dht_rmt_decode(edata->received_symbols, edata->num_symbols, res.data);
+    xQueueOverwriteFromISR(handle->results, &res, &woken);
+
+    return woken == pdTRUE;
+}
+
+// End of the start pulse: arm the receiver, then release the line
+static void dht_rmt_start_timer_cb(void *arg)
+{
+    dht_rmt_handle_t handle = (dht_rmt_handle_t)arg;
+
+    if (rmt_receive(handle->channel, handle->symbols, sizeof(handle->symbols), &receive_config) != ESP_OK)
+    {
+        dht_rmt_result_t res = { .result = ESP_FAIL };
+        xQueueOverwrite(handle->results, &res);
+    }
+    gpio_set_level(handle->pin, 1);
+}
+
+/**
+ * An enabled channel holds an APB_FREQ_MAX power management lock, which
+ * keeps the chip out of light sleep. Keep it enabled only while a read is
+ * in progress.
+ */
+static esp_err_t dht_rmt_enable(dht_rmt_handle_t handle)
+{
+    if (handle->enabled)
+        return ESP_OK;
+
+    esp_err_t err = rmt_enable(handle->channel);
+    if (err == ESP_OK)
+        handle->enabled = true;
+    return err;
+}
+
+// Also cancels a pending receive
+static void dht_rmt_disable(dht_rmt_handle_t handle)
+{
+    if (!handle->enabled)
+        return;
+
+    rmt_disable(handle->channel);
+    handle->enabled = false;
+}
+
+dht_rmt_handle_t dht_rmt_find(gpio_num_t pin)
+{
+    for (int i = 0; i < DHT_RMT_MAX_HANDLES; i++)
+        if (handles[i] && handles[i]->pin == pin)
+            return handles[i];
+    return NULL;
+}
+
+esp_err_t dht_rmt_new(gpio_num_t pin, dht_rmt_handle_t *ret_handle)
+{
+    if (!ret_handle || dht_rmt_find(pin))
+        return ESP_ERR_INVALID_ARG;
+
+    int slot = -1;
+    for (int i = 0; i < DHT_RMT_MAX_HANDLES && slot < 0; i++)
+        if (!handles[i])
+            slot = i;
+    if (slot < 0)
+        return ESP_ERR_NO_MEM;
+
+    dht_rmt_handle_t handle = calloc(1, sizeof(struct dht_rmt_t));
+    if (!handle)
+        return ESP_ERR_NO_MEM;
+    handle->pin = pin;
+
+    esp_err_t err = ESP_ERR_NO_MEM;
+    handle->results = xQueueCreate(1, sizeof(dht_rmt_result_t));
+    if (!handle->results)
+        goto fail;
+
+    rmt_rx_channel_config_t channel_config = {
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = DHT_RMT_RESOLUTION_HZ,
+        .mem_block_symbols = DHT_RMT_MEM_SYMBOLS,
+        .gpio_num = pin,
+    };
+    err = rmt_new_rx_channel(&channel_config, &handle->channel);
+    if (err != ESP_OK)
+        goto fail;
+
+    rmt_rx_event_callbacks_t cbs = {
+        .on_recv_done = dht_rmt_on_recv_done,
+    };
+    err = rmt_rx_register_event_callbacks(handle->channel, &cbs, handle);
+    if (err != ESP_OK)
+        goto fail;
+
+    esp_timer_create_args_t timer_args = {
+        .callback = dht_rmt_start_timer_cb,
+        .arg = handle,
+        .name = "dht_start",
+    };
+    err = esp_timer_create(&timer_args, &handle->start_timer);
+    if (err != ESP_OK)
+        goto fail;
+
+    // The RMT routes the pad to its input; drive the start pulse as open drain on top
+    gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_pull_mode(pin, GPIO_PULLUP_ONLY);
+    gpio_set_level(pin, 1);
+
+    handles[slot] = handle;
+    *ret_handle = handle;
+    return ESP_OK;
+
+fail:
+    ESP_LOGE(TAG, "Failed to create RMT backend on GPIO %d: %s", pin, esp_err_to_name(err));
+    if (handle->channel)
+        rmt_del_channel(handle->channel);
+    if (handle->results)
+        vQueueDelete(handle->results);
+    free(handle);
+    return err;
+}
+
+esp_err_t dht_rmt_del(dht_rmt_handle_t handle)
+{
+    CHECK_ARG(handle);
+
+    for (int i = 0; i < DHT_RMT_MAX_HANDLES; i++)
+        if (handles[i] == handle)
+            handles[i] = NULL;
+
+    esp_timer_stop(handle->start_timer);
+    esp_timer_delete(handle->start_timer);
+    dht_rmt_disable(handle);
+    rmt_del_channel(handle->channel);
+    vQueueDelete(handle->results);
+    free(handle);
+
+    return ESP_OK;
+}
+
+esp_err_t dht_rmt_start(dht_rmt_handle_t handle, dht_sensor_type_t sensor_type)
+{
+    CHECK_ARG(handle);
+
+    xQueueReset(handle->results);
+
+    esp_err_t err = dht_rmt_enable(handle);
+    if (err != ESP_OK)
+        return err;
+
+    // Phase 'A', the timer callback ends it
+    gpio_set_level(handle->pin, 0);
+    uint64_t pulse_us = sensor_type == DHT_TYPE_SI7021
+            ? DHT_SI7021_START_PULSE_US
+            : DHT_START_PULSE_MS * 1000;
+    err = esp_timer_start_once(handle->start_timer, pulse_us);
+    if (err != ESP_OK)
+    {
+        gpio_set_level(handle->pin, 1);
+        dht_rmt_disable(handle);
+    }
+
+    return err;
+}
+
+esp_err_t dht_rmt_get_data(dht_rmt_handle_t handle, dht_sensor_type_t sensor_type, TickType_t timeout,
+        int16_t *humidity, int16_t *temperature)
+{
+    CHECK_ARG(handle && (humidity || temperature));
+
+    dht_rmt_result_t res;
+    if (xQueueReceive(handle->results, &res, timeout) != pdTRUE)
+    {
+        if (timeout == 0)
+            return ESP_ERR_NOT_FINISHED;
+
+        // No response from the sensor, cancel the pending receive
+        esp_timer_stop(handle->start_timer);
+        dht_rmt_disable(handle);
+        gpio_set_level(handle->pin, 1);
+        return ESP_ERR_TIMEOUT;
+    }
+    dht_rmt_disable(handle);
+
+    if (res.result != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to decode pulse train: %s", esp_err_to_name(res.result));
+        return res.result;
+    }
+
+    return dht_decode_data(sensor_type, res.data, humidity, temperature);
+}
@@ -0,0 +1,61 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Flush when this many records are queued...
+#define BATCH_MAX_RECORDS   16
+// ...or when the oldest record is this old
+#define BATCH_MAX_AGE_MS    60000
+// Encoded batch buffer, fits BATCH_MAX_RECORDS worst-case records
+#define BATCH_BUFFER_SIZE   2048
+
+// Upload wire format. The backend picks the decoder from Content-Type.
+// LEGACY posts one record per request in the original single-record schema
+// to SERVER_URL; JSON and CBOR post whole batches to BATCH_URL (http.h).
+// Stay on LEGACY until the backend serves the batch endpoint.
+#define BATCH_FORMAT_JSON   0
+#define BATCH_FORMAT_CBOR   1
+#define BATCH_FORMAT_LEGACY 2
+#define BATCH_FORMAT        BATCH_FORMAT_LEGACY
+
+// One coalesced telemetry snapshot
+typedef struct {
+    int64_t timestamp_us;       // uptime_us() when taken
+    int fall_events;
+    int overtemp_events;
+    int overhum_events;
+    bool has_location;
+    double longitude;
+    double latitude;
+} batch_record_t;
+
+typedef struct {
+    uint32_t events;            // Records delivered
+    uint32_t requests;          // Batches delivered
+    uint32_t bytes;             // Payload bytes delivered
+    uint32_t dropped;           // Records discarded because the queue was full
+    uint32_t spilled;           // Records moved to the flash log (tlog.h)
+    uint32_t rejected;          // Records the backend refused, dropped
+    int64_t since_us;           // Start of the measurement window
+} batch_stats_t;
+
+// Function prototypes
+void batch_add(const batch_record_t *record);
+size_t batch_count(void);
+bool batch_should_flush(bool urgent);
+size_t batch_encode_json(char *buf, size_t buf_len);
+size_t batch_encode_cbor(uint8_t *buf, size_t buf_len);
+size_t batch_encode_legacy(char *buf, size_t buf_len);
+size_t batch_encode(uint8_t *buf, size_t buf_len);
+const char *batch_content_type(void);
+void batch_commit(size_t sent_bytes);
+void batch_reject(void);
+void batch_spill(void);
+int batch_encoded_falls(void);
+void batch_get_stats(batch_stats_t *stats_out);
+void batch_log_stats(void);
+
+#endif // BATCH_H
@@ -0,0 +1,31 @@
+#ifndef CBOR_H
+#define CBOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Minimal RFC 8949 CBOR writer into a caller-supplied buffer. Nothing is
+// written past cap; once an item does not fit, overflow is set and every
+// later put is ignored. Save len before an item to roll it back.
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    bool overflow;
+} cbor_writer_t;
+
+// Function prototypes
+void cbor_writer_init(cbor_writer_t *w, uint8_t *buf, size_t cap);
+void cbor_rollback(cbor_writer_t *w, size_t len);
+void cbor_put_uint(cbor_writer_t *w, uint64_t value);
+void cbor_put_int(cbor_writer_t *w, int64_t value);
+void cbor_put_text(cbor_writer_t *w, const char *text);
+void cbor_put_float(cbor_writer_t *w, float value);
+void cbor_put_bool(cbor_writer_t *w, bool value);
+void cbor_start_map(cbor_writer_t *w, size_t pairs);
+void cbor_start_array(cbor_writer_t *w, size_t items);
+void cbor_start_indefinite_array(cbor_writer_t *w);
+void cbor_end_indefinite(cbor_writer_t *w);
+
+#endif // CBOR_H
@@ -0,0 +1,38 @@
+#ifndef DUTY_H
+#define DUTY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "net.h"
+
+// Set to 1 for long shipments: instead of starting the always-on tasks,
+// wake on a timer, sample, upload when needed and go back to deep sleep.
+#define DUTY_CYCLE_MODE         0
+
+#define DUTY_SLEEP_S            300     // Deep sleep between wakes
+#define DUTY_IMU_BURST_MS       500     // Accelerometer sampling per wake
+// Upload at least every Nth wake, sooner on an alert
+#define DUTY_UPLOAD_EVERY       12
+#define DUTY_WIFI_TIMEOUT_MS    8000    // Give up on the link and store to flash
+// Change of the resting gravity vector that means the package was moved
+// and the location should be refreshed on the next upload
+#define DUTY_MOVED_MG           250
+// WiFi bring-up and the TLS handshake run on this task, so it gets the
+// network worker stack; the main task's 3584 bytes are not enough
+#define DUTY_TASK_STACK         NET_TASK_STACK
+#define DUTY_TASK_PRIO          NET_TASK_PRIO
+
+// Per-wake timing, kept in RTC memory
+typedef struct {
+    uint32_t cycles;            // Timer wakes since the last cold boot
+    uint32_t uploads;
+    uint32_t last_awake_ms;     // App start to deep sleep for the last wake
+    uint32_t max_awake_ms;
+    uint64_t total_awake_ms;
+} duty_stats_t;
+
+// Function prototypes
+void duty_cycle_task(void *pvParameter);
+void duty_get_stats(duty_stats_t *stats_out);
+
+#endif // DUTY_H
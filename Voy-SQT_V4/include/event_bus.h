@@ -0,0 +1,84 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Number of events retained, must be a power of two
+#define EVENT_BUS_CAPACITY 64
+
+typedef enum {
+    EVENT_FALL = 0,
+    EVENT_TEMP,
+    EVENT_HUMIDITY,
+    EVENT_LOCATION,
+    EVENT_HEALTH,
+    EVENT_NUM_TYPES,
+} event_type_t;
+
+#define EVENT_MASK(type) (1u << (type))
+#define EVENT_MASK_ALL   ((1u << EVENT_NUM_TYPES) - 1)
+
+typedef struct {
+    uint32_t peak_mg;
+    uint16_t freefall_ms;
+    bool settled;
+} event_fall_t;
+
+typedef struct {
+    float value;        // Degrees Celsius or percent RH
+    bool over_limit;    // Crossed the alert threshold
+} event_env_t;
+
+typedef struct {
+    double latitude;
+    double longitude;
+    double accuracy;            // Meters, 0 if unknown
+} event_location_t;
+
+typedef struct {
+    uint32_t free_heap;
+    uint32_t min_free_heap;
+    uint32_t dht_max_critical_us;
+    uint32_t loc_cache_hits;
+    uint32_t loc_cache_misses;
+    uint8_t backend_link;       // retry_state_t of the backend
+    uint8_t geo_link;           // retry_state_t of the geolocation API
+    uint32_t backend_refused;   // Uploads held back by backoff or an open breaker
+    uint32_t geo_refused;
+    uint32_t wifi_cold_boot_ms;     // Time to the first IP after boot
+    uint32_t wifi_reconnect_ms;     // Time to IP for the last reconnect
+    uint32_t wifi_reconnects;
+    uint32_t wifi_scan_ms;          // Duration of the last geolocation scan
+} event_health_t;
+
+typedef struct {
+    int64_t timestamp_us;   // esp_timer_get_time() at publish
+    uint32_t seq;           // Bus-wide sequence number
+    event_type_t type;
+    union {
+        event_fall_t fall;
+        event_env_t env;
+        event_location_t location;
+        event_health_t health;
+    };
+} event_t;
+
+// Each subscriber reads the shared ring through its own cursor
+typedef struct {
+    uint32_t cursor;        // Sequence number of the next event to read
+    uint32_t mask;          // EVENT_MASK() of the types this subscriber wants
+    uint32_t overflows;     // Matching events overwritten before this subscriber read them
+    uint32_t passed;        // Matching events published before cursor, internal
+    TaskHandle_t notify;    // Optional task to notify on matching publishes
+} event_sub_t;
+
+// Function prototypes
+void event_bus_publish(event_type_t type, const event_t *payload);
+void event_bus_subscribe(event_sub_t *sub, uint32_t mask, TaskHandle_t notify);
+bool event_bus_read(event_sub_t *sub, event_t *event_out);
+
+#endif // EVENT_BUS_H
@@ -0,0 +1,62 @@
+#ifndef FALL_CAPTURE_H
+#define FALL_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "imu_ring.h"
+
+// Window around the trigger, in samples (~256 ms each side at 1 kHz).
+// PRE + POST must be a power of two, it sizes the history ring.
+#define FALL_CAPTURE_PRE_SAMPLES   256
+#define FALL_CAPTURE_POST_SAMPLES  256
+#define FALL_CAPTURE_HISTORY       (FALL_CAPTURE_PRE_SAMPLES + FALL_CAPTURE_POST_SAMPLES)
+
+// Number of encoded captures that can wait for upload at once
+#define FALL_CAPTURE_SLOTS         2
+
+#define FALL_CAPTURE_VERSION       1
+
+// Blob header, followed by zigzag-varint deltas (x, y, z per sample)
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t reserved;
+    uint16_t num_samples;
+    uint16_t pre_samples;       // Samples before the trigger sample
+    uint16_t sample_period_us;
+    uint32_t trigger_us;        // Timestamp of the trigger sample
+    int16_t first[3];           // Absolute x, y, z of samples[0]
+} fall_capture_header_t;
+
+// Worst case is two varint bytes per axis per sample
+#define FALL_CAPTURE_MAX_BLOB (sizeof(fall_capture_header_t) + FALL_CAPTURE_HISTORY * 3 * 2)
+
+typedef struct {
+    atomic_bool in_use;
+    size_t len;
+    uint8_t data[FALL_CAPTURE_MAX_BLOB];
+} fall_capture_blob_t;
+
+typedef struct {
+    imu_sample_t history[FALL_CAPTURE_HISTORY];
+    uint32_t head;              // Total samples pushed
+    bool armed;                 // Trigger seen, collecting post-trigger samples
+    uint32_t post_remaining;
+    uint32_t trigger_us;
+    uint32_t dropped;           // Captures lost because no slot was free
+    fall_capture_blob_t slots[FALL_CAPTURE_SLOTS];
+} fall_capture_t;
+
+// Sealed blobs (fall_capture_blob_t *) waiting for upload
+extern QueueHandle_t fall_capture_queue;
+
+// Function prototypes
+void fall_capture_init(fall_capture_t *cap);
+void fall_capture_push(fall_capture_t *cap, const imu_sample_t *sample);
+void fall_capture_trigger(fall_capture_t *cap, uint32_t trigger_us);
+void fall_capture_release(fall_capture_blob_t *blob);
+
+#endif // FALL_CAPTURE_H
@@ -0,0 +1,68 @@
+#ifndef FALL_DETECTOR_H
+#define FALL_DETECTOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "imu_ring.h"
+
+// Nominal ADXL327 calibration at 3.3 V supply through ADC_ATTEN_DB_12
+#define FALL_DEFAULT_ZERO_G_COUNTS  2048
+#define FALL_DEFAULT_COUNTS_PER_G   573
+
+typedef enum {
+    FALL_STATE_IDLE = 0,
+    FALL_STATE_FREEFALL,    // |a| below free-fall threshold
+    FALL_STATE_IMPACT_WAIT, // Free fall ended, waiting for the impact spike
+    FALL_STATE_STILLNESS,   // Impact seen, waiting for the package to settle
+} fall_state_t;
+
+typedef struct {
+    // Calibration
+    int16_t zero_g_counts[3];       // Raw ADC counts at 0 g, per axis
+    int16_t counts_per_g;           // Raw ADC counts per 1 g
+
+    // Stage 1: free fall
+    uint16_t freefall_threshold_mg; // |a| below this counts as free fall
+    uint16_t freefall_min_ms;       // Minimum free-fall duration to arm
+
+    // Stage 2: impact
+    uint16_t impact_threshold_mg;   // |a| at or above this counts as impact
+    uint16_t impact_window_ms;      // Time after free fall ends to see the impact
+
+    // Stage 3: stillness
+    uint16_t stillness_tolerance_mg;// Allowed deviation of |a| from 1 g while at rest
+    uint16_t stillness_ms;          // Time |a| must stay near 1 g to confirm
+    uint16_t stillness_timeout_ms;  // Report unsettled if not still within this time
+} fall_detector_config_t;
+
+typedef struct {
+    uint32_t timestamp_us;          // Time of the impact
+    uint32_t freefall_ms;           // Duration of the free-fall stage
+    uint32_t peak_mg;               // Peak |a| between free fall and stillness
+    bool settled;                   // False if stillness timed out
+} fall_event_t;
+
+typedef struct {
+    fall_detector_config_t config;
+
+    // Thresholds pre-squared in raw counts so the sample path is multiply/compare only
+    int32_t freefall_sq;
+    int32_t impact_sq;
+    int32_t still_low_sq;
+    int32_t still_high_sq;
+
+    fall_state_t state;
+    uint32_t freefall_start_us;
+    uint32_t freefall_end_us;
+    uint32_t impact_us;
+    uint32_t still_start_us;
+    bool still_active;
+    int32_t peak_sq;
+} fall_detector_t;
+
+// Function prototypes
+void fall_detector_default_config(fall_detector_config_t *config);
+void fall_detector_init(fall_detector_t *fd, const fall_detector_config_t *config);
+bool fall_detector_update(fall_detector_t *fd, const imu_sample_t *sample, fall_event_t *event_out);
+
+#endif // FALL_DETECTOR_H
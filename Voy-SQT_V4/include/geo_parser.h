@@ -0,0 +1,53 @@
+#ifndef GEO_PARSER_H
+#define GEO_PARSER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Longest key remembered per level, longer keys never match
+#define GEO_PARSER_KEY_MAX    16
+// Levels whose keys are remembered ("location" -> "lat")
+#define GEO_PARSER_PATH_DEPTH 2
+// Containers tracked, deeper documents are rejected
+#define GEO_PARSER_MAX_DEPTH  16
+// Longest number literal kept for conversion
+#define GEO_PARSER_TOKEN_MAX  32
+
+#define GEO_FOUND_LAT         0x01
+#define GEO_FOUND_LNG         0x02
+#define GEO_FOUND_ACCURACY    0x04
+#define GEO_FOUND_ERROR       0x08
+
+// Incremental scanner for a geolocation API response. Picks location.lat,
+// location.lng, accuracy and error.code out of the body as it arrives in
+// arbitrary chunks, without buffering the body or building a tree.
+typedef struct {
+    // Results
+    double lat;
+    double lng;
+    double accuracy;
+    int error_code;
+    uint8_t found;              // GEO_FOUND_* bits
+    bool failed;                // Malformed or too deeply nested
+
+    // Scanner state
+    uint8_t depth;
+    uint16_t is_object;         // Bit per depth: object (1) or array (0)
+    bool in_string;
+    bool escape;
+    bool expect_key;
+    bool string_is_key;
+    uint8_t key_len;
+    char key[GEO_PARSER_KEY_MAX];
+    char path[GEO_PARSER_PATH_DEPTH][GEO_PARSER_KEY_MAX];
+    uint8_t token_len;
+    char token[GEO_PARSER_TOKEN_MAX];
+} geo_parser_t;
+
+// Function prototypes
+void geo_parser_init(geo_parser_t *p);
+void geo_parser_feed(geo_parser_t *p, const char *data, size_t len);
+bool geo_parser_finish(geo_parser_t *p);
+
+#endif // GEO_PARSER_H
@@ -3,6 +3,8 @@
 
 #include <stdio.h>
 #include "freertos/queue.h"
+#include "loc_cache.h"
+#include "retry.h"
 
 #ifdef USE_PRIVATE_CONFIG
 #include "private_config.h"
@@ -12,15 +14,17 @@
 
 #define MAX_APS 8
 
-extern QueueHandle_t wifi_json_queue;
-
 typedef struct {
     double longitude;
     double latitude;
+    double accuracy;          // Radius in meters, 0 if not reported
 } long_lat_t;
 
 extern long_lat_t global_location; // Declaration of the global variable
 
+// Backoff and circuit breaker for the geolocation API, initialized in app_main
+extern retry_policy_t geo_retry;
+
 // Define a structure to hold WiFi access point details.
 typedef struct {
     char mac[18];             
@@ -28,11 +32,31 @@ typedef struct {
     int signal_to_noise_ratio;
 } wifi_ap_t;
 
+// Geolocation request body, worst case is ~85 bytes per AP plus the envelope
+#define WIFI_SCAN_JSON_MAX (MAX_APS * 96 + 48)
+
+// One geolocation request body and the cache key for its fix
+typedef struct {
+    loc_fingerprint_t fingerprint;  // Cache key for the fix this request returns
+    size_t len;
+    char json[WIFI_SCAN_JSON_MAX];
+} wifi_scan_json_t;
+
+// Persistent geolocation connection statistics
+typedef struct {
+    uint32_t requests;
+    uint32_t handshakes;        // New connections (TCP + TLS, full or resumed)
+    uint32_t errors;
+    uint64_t handshake_time_us; // Total time to connect and finish the handshake
+    uint64_t request_time_us;   // Total time on requests over open connections
+} geo_client_stats_t;
+
 // Function prototypes
 esp_err_t _geolocation_event_handler(esp_http_client_event_t *evt);
 void pretty_print_json(const char *json_str);
 wifi_ap_t *create_wifi_aps_array(size_t *num_aps_out);
-char *generate_wifi_scan_json(const wifi_ap_t *wifi_aps, size_t num_aps);
-long_lat_t process_geolocation_json(char *json_str);
+size_t generate_wifi_scan_json(const wifi_ap_t *wifi_aps, size_t num_aps, char *buf, size_t buf_len);
+bool process_geolocation_json(const char *json_str, size_t json_len, long_lat_t *loc_out);
+void geolocation_get_client_stats(geo_client_stats_t *stats_out);
 
 #endif // GEOLOCATION_H
\ No newline at end of file
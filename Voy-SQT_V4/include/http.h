@@ -2,12 +2,48 @@
 #define HTTP_H
 
 #include "esp_http_client.h"
+#include "retry.h"
+#include "batch.h"
 
-// DHT11 Temperature/Humidity Sensor Pins
+// Backend endpoints. All are POSTs and only a 2xx counts as delivered.
+// SERVER_URL:   one record per request, the original schema
+//               {"uid","long","lat","fall","temp","hum"}, application/json.
+//               Used while BATCH_FORMAT is BATCH_FORMAT_LEGACY.
+// BATCH_URL:    not deployed yet. Takes {"uid","events":[...]} from the RAM
+//               queue, or {"uid","now":{"boot","t"},"events":[...]} from the
+//               flash log (see batch.c/tlog.c), as application/json or
+//               application/cbor per Content-Type.
+// WAVEFORM_URL: not deployed yet. One fall waveform per request,
+//               application/octet-stream (layout in fall_capture.h). Until
+//               it exists the backend answers 404, the waveform is dropped
+//               and counted as rejected.
 #define SERVER_URL   "http://192.168.22.136:8000/sensors/sensor_data"
+#define BATCH_URL    "http://192.168.22.136:8000/sensors/sensor_data/batch"
+#define WAVEFORM_URL "http://192.168.22.136:8000/sensors/fall_waveform"
+
+#if BATCH_FORMAT == BATCH_FORMAT_LEGACY
+#define BATCH_UPLOAD_URL SERVER_URL
+#else
+#define BATCH_UPLOAD_URL BATCH_URL
+#endif
+
+// Persistent backend connection statistics
+typedef struct {
+    uint32_t requests;          // POSTs attempted
+    uint32_t connects;          // New TCP connections opened
+    uint32_t errors;            // Failed POSTs, each one drops the connection
+    uint32_t rejected;          // Answered with a non-2xx status other than 429/5xx
+    uint64_t connect_time_us;   // Total time spent opening connections
+    uint64_t request_time_us;   // Total time spent on requests over open connections
+} http_uploader_stats_t;
+
+// Backoff and circuit breaker for the backend, initialized in app_main
+extern retry_policy_t backend_retry;
 
 // Function prototypes
 esp_err_t _backend_http_event_handler(esp_http_client_event_t *evt);
-void send_post_request(int fall_events, int overtemp_events, int overhum_events, double longitude, double latitude);
+esp_err_t send_batch_request(const void *data, size_t len, const char *content_type);
+esp_err_t send_waveform_request(const uint8_t *blob, size_t len);
+void http_get_uploader_stats(http_uploader_stats_t *stats_out);
 
 #endif // HTTP_H
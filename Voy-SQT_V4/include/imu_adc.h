@@ -0,0 +1,50 @@
+#ifndef IMU_ADC_H
+#define IMU_ADC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "sensors.h"
+
+// Per-axis output sample rate limits (Hz)
+#define IMU_ADC_MIN_RATE_HZ     400
+#define IMU_ADC_MAX_RATE_HZ     2000
+#define IMU_ADC_DEFAULT_RATE_HZ 1000
+
+// Number of decimated 3-axis samples handed out per frame
+#define IMU_ADC_FRAME_SAMPLES   32
+
+// A block of consecutive, evenly spaced accelerometer samples
+typedef struct {
+    int64_t timestamp_us;       // esp_timer time of samples[0], from the DMA completion
+    uint32_t sample_period_us;  // Spacing between consecutive samples
+    uint32_t sequence;          // Frame counter, gaps indicate dropped frames
+    size_t num_samples;
+    imu_data_t samples[IMU_ADC_FRAME_SAMPLES];
+} imu_frame_t;
+
+// Called from the acquisition task for every complete frame.
+// The frame is only valid for the duration of the call.
+typedef void (*imu_frame_cb_t)(const imu_frame_t *frame, void *arg);
+
+typedef struct {
+    uint32_t sample_rate_hz;    // Per-axis rate, IMU_ADC_MIN_RATE_HZ..IMU_ADC_MAX_RATE_HZ
+    imu_frame_cb_t on_frame;    // Optional frame consumer
+    void *on_frame_arg;
+} imu_adc_config_t;
+
+typedef struct {
+    uint32_t sample_rate_hz;    // Effective per-axis rate
+    uint32_t conv_rate_hz;      // Raw ADC conversion rate across all axes
+    uint32_t oversample;        // Raw conversions averaged into one output sample
+    uint32_t frames;            // Frames delivered
+    uint32_t dma_overflows;     // DMA pool overflows reported by the driver
+} imu_adc_stats_t;
+
+// Function prototypes
+esp_err_t imu_adc_start(const imu_adc_config_t *config);
+esp_err_t imu_adc_stop(void);
+imu_data_t imu_adc_get_latest(void);
+void imu_adc_get_stats(imu_adc_stats_t *stats_out);
+
+#endif // IMU_ADC_H
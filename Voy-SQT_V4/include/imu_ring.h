@@ -0,0 +1,44 @@
+#ifndef IMU_RING_H
+#define IMU_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+// Default capacity of the shared accelerometer ring, must be a power of two
+#define IMU_RING_CAPACITY 2048
+
+// Packed accelerometer sample, 10 bytes
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp_us;  // Low 32 bits of esp_timer_get_time(), wraps every ~71 min
+    int16_t x;
+    int16_t y;
+    int16_t z;
+} imu_sample_t;
+
+// Lock-free ring written by a single producer (ISR or high-priority task).
+// The producer never waits on readers; a reader that falls more than
+// `capacity` samples behind loses the oldest samples and sees them counted
+// in its `dropped` field.
+typedef struct {
+    imu_sample_t *buffer;
+    uint32_t mask;          // capacity - 1
+    _Atomic uint32_t head;  // Total samples ever pushed
+} imu_ring_t;
+
+// Each consumer stage owns one reader and reads at its own pace
+typedef struct {
+    uint32_t tail;          // Index of the next sample to read
+    uint32_t dropped;       // Samples overwritten before this reader got to them
+} imu_ring_reader_t;
+
+extern imu_ring_t imu_ring;
+
+// Function prototypes
+void imu_ring_init(imu_ring_t *ring, imu_sample_t *storage, size_t capacity);
+void imu_ring_push(imu_ring_t *ring, const imu_sample_t *sample);
+void imu_ring_reader_init(imu_ring_t *ring, imu_ring_reader_t *reader);
+size_t imu_ring_available(imu_ring_t *ring, const imu_ring_reader_t *reader);
+size_t imu_ring_read(imu_ring_t *ring, imu_ring_reader_t *reader, imu_sample_t *out, size_t max_samples);
+
+#endif // IMU_RING_H
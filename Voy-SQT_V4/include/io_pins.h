@@ -2,15 +2,15 @@
 #define IO_PINS_H
 
 #include "driver/gpio.h"  // ESP-IDF GPIO driver
-#include "driver/adc.h"  // ESP-IDF GPIO driver
+#include "hal/adc_types.h"  // ESP-IDF ADC channel definitions
 
 // DHT11 Temperature/Humidity Sensor Pins
 #define TEMP_HUM_PIN   GPIO_NUM_33
 
-// ADXL327 Accelerometer Pins
-#define IMU_X_PIN       ADC1_CHANNEL_4
-#define IMU_Y_PIN       ADC1_CHANNEL_6
-#define IMU_Z_PIN       ADC1_CHANNEL_7
+// ADXL327 Accelerometer Pins (ADC1 channels, sampled by imu_adc)
+#define IMU_X_PIN       ADC_CHANNEL_4
+#define IMU_Y_PIN       ADC_CHANNEL_6
+#define IMU_Z_PIN       ADC_CHANNEL_7
 #define IMU_TEST_PIN    GPIO_NUM_14
 
 // I2C Pins
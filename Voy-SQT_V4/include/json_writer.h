@@ -0,0 +1,36 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Deepest object/array nesting the writer tracks
+#define JSON_WRITER_MAX_DEPTH 8
+
+// Streaming JSON writer into a fixed buffer. Never allocates, never writes
+// past cap and always leaves room for the terminating NUL. Once something
+// does not fit, overflow is set and the rest of the document is ignored.
+typedef struct {
+    char *buf;
+    size_t cap;
+    size_t len;
+    bool overflow;
+    uint8_t depth;
+    bool after_key;             // Next value belongs to the key just written
+    uint32_t has_items;         // Bit per depth: container already has a member
+} json_writer_t;
+
+// Function prototypes
+void json_writer_init(json_writer_t *w, char *buf, size_t cap);
+void json_begin_object(json_writer_t *w);
+void json_end_object(json_writer_t *w);
+void json_begin_array(json_writer_t *w);
+void json_end_array(json_writer_t *w);
+void json_key(json_writer_t *w, const char *key);
+void json_string(json_writer_t *w, const char *value);
+void json_int(json_writer_t *w, int32_t value);
+void json_bool(json_writer_t *w, bool value);
+size_t json_writer_finish(json_writer_t *w);
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,42 @@
+#ifndef LOC_CACHE_H
+#define LOC_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// Fingerprints are built from at most this many APs (matches MAX_APS)
+#define LOC_FINGERPRINT_MAX_APS  8
+
+#define LOC_CACHE_ENTRIES        8
+// Minimum Jaccard similarity of the BSSID sets, in percent
+#define LOC_CACHE_MIN_JACCARD    60
+// Maximum mean RSSI difference over the shared BSSIDs, in dB
+#define LOC_CACHE_RSSI_TOLERANCE 10
+// Set to 0 to keep the cache in RAM only
+#define LOC_CACHE_PERSIST        1
+#define LOC_CACHE_NVS_NAMESPACE  "loc_cache"
+
+// Set of observed BSSIDs, kept sorted by hash for a linear-time merge
+typedef struct {
+    uint8_t count;
+    uint32_t bssid_hash[LOC_FINGERPRINT_MAX_APS];
+    int8_t rssi[LOC_FINGERPRINT_MAX_APS];
+} loc_fingerprint_t;
+
+typedef struct {
+    uint32_t hits;              // Lookups answered from the cache
+    uint32_t misses;            // Lookups that need a geolocation request
+    uint32_t inserts;
+    uint32_t evictions;         // Least recently used entries replaced
+} loc_cache_stats_t;
+
+// Function prototypes
+esp_err_t loc_cache_init(void);
+void loc_fingerprint_add(loc_fingerprint_t *fp, const char *mac, int rssi);
+bool loc_cache_lookup(const loc_fingerprint_t *fp, double *latitude, double *longitude, double *accuracy);
+void loc_cache_insert(const loc_fingerprint_t *fp, double latitude, double longitude, double accuracy);
+void loc_cache_get_stats(loc_cache_stats_t *stats_out);
+
+#endif // LOC_CACHE_H
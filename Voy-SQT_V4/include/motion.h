@@ -0,0 +1,56 @@
+#ifndef MOTION_H
+#define MOTION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "imu_ring.h"
+
+// Sum of per-axis deviations from the slow baseline that counts as activity
+#define MOTION_ACTIVITY_MG        80
+// Baseline time constant, 2^MOTION_BASELINE_SHIFT samples (~256 ms at 1 kHz)
+#define MOTION_BASELINE_SHIFT     8
+// No activity for this long ends a movement
+#define MOTION_STILL_MS           10000
+// Movements shorter than this (bumps, taps) do not trigger a scan
+#define MOTION_SIGNIFICANT_MS     3000
+
+// Scan cadence while moving
+#define MOTION_SCAN_MOVING_MS     120000
+// Scan cadence while stationary, doubling from MIN to MAX
+#define MOTION_SCAN_IDLE_MIN_MS   600000
+#define MOTION_SCAN_IDLE_MAX_MS   3600000
+
+// Event group bits
+#define MOTION_MOVING_BIT         BIT0    // Level: currently moving
+#define MOTION_SETTLED_BIT        BIT1    // Edge: a significant movement just ended
+
+typedef enum {
+    MOTION_SCAN_SETTLED = 0,    // Movement ended, position likely changed
+    MOTION_SCAN_MOVING,         // Periodic scan while moving
+    MOTION_SCAN_IDLE,           // Backed-off scan while stationary
+    MOTION_SCAN_NUM_REASONS,
+} motion_scan_reason_t;
+
+typedef struct {
+    int32_t activity_counts;    // MOTION_ACTIVITY_MG in raw counts
+    int32_t baseline[3];        // Scaled by 2^MOTION_BASELINE_SHIFT
+    bool primed;
+    bool moving;
+    uint32_t moving_since_us;
+    uint32_t last_active_us;
+} motion_tracker_t;
+
+typedef struct {
+    uint32_t scans[MOTION_SCAN_NUM_REASONS];
+    uint32_t movements;         // Significant movements seen
+} motion_stats_t;
+
+// Function prototypes
+void motion_init(motion_tracker_t *tracker, int16_t counts_per_g);
+void motion_update(motion_tracker_t *tracker, const imu_sample_t *sample);
+motion_scan_reason_t motion_wait_scan_slot(void);
+void motion_get_stats(motion_stats_t *stats_out);
+
+#endif // MOTION_H
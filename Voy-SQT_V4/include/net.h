@@ -0,0 +1,40 @@
+#ifndef NET_H
+#define NET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// Independent request channels, each with its own worker task and client,
+// so a slow geolocation fix never holds up a telemetry upload
+typedef enum {
+    NET_CHANNEL_BACKEND = 0,
+    NET_CHANNEL_GEOLOCATION,
+    NET_NUM_CHANNELS,
+} net_channel_t;
+
+// Requests that can wait per channel before net_submit starts refusing
+#define NET_QUEUE_DEPTH  4
+#define NET_TASK_STACK   4096
+#define NET_TASK_PRIO    5
+
+// Runs the blocking request in the channel's worker task
+typedef esp_err_t (*net_run_fn_t)(void *ctx);
+// Completion callback, runs in the worker task right after run. Keep it
+// short and hand results back to the owning task (queue, event bits).
+typedef void (*net_done_fn_t)(esp_err_t err, void *ctx);
+
+typedef struct {
+    uint32_t submitted;
+    uint32_t rejected;          // Queue full
+    uint32_t completed;
+    uint32_t failed;            // run returned an error
+    uint32_t in_flight;         // Queued or running right now
+} net_stats_t;
+
+// Function prototypes
+esp_err_t net_init(void);
+esp_err_t net_submit(net_channel_t channel, net_run_fn_t run, net_done_fn_t done, void *ctx);
+void net_get_stats(net_channel_t channel, net_stats_t *stats_out);
+
+#endif // NET_H
@@ -0,0 +1,37 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Dynamic frequency scaling range. The CPU runs at the max only while a
+// lock below (or a driver lock) asks for it, and drops to the XTAL
+// frequency or light sleep otherwise.
+#define POWER_MAX_FREQ_MHZ      160
+#define POWER_MIN_FREQ_MHZ      40
+#define POWER_LIGHT_SLEEP       1
+
+// Beacon intervals between wakeups to listen for buffered traffic while
+// in WiFi modem sleep. Higher saves more, at the cost of downlink latency.
+#define POWER_WIFI_LISTEN_INTERVAL  3
+
+// Held only while the work is in progress
+typedef enum {
+    POWER_LOCK_SENSOR = 0,      // DHT read, pulse timing must not stretch
+    POWER_LOCK_NET,             // HTTP transaction, TLS at full speed
+    POWER_NUM_LOCKS,
+} power_lock_t;
+
+typedef struct {
+    uint32_t acquires;
+    uint64_t held_us;           // Total time held
+} power_lock_stats_t;
+
+// Function prototypes
+esp_err_t power_init(void);
+void power_lock_acquire(power_lock_t lock);
+void power_lock_release(power_lock_t lock);
+void power_get_lock_stats(power_lock_t lock, power_lock_stats_t *stats_out);
+void power_log_report(void);
+
+#endif // POWER_H
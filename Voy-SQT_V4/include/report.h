@@ -0,0 +1,33 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+// Routine telemetry is coalesced and flushed at most this often
+#define REPORT_COALESCE_MS 5000
+
+// Event group bits used to wake the uploader
+#define REPORT_FALL_BIT     BIT0    // Urgent, flushed immediately
+#define REPORT_NET_DONE_BIT BIT1    // A network request finished, collect its result
+#define REPORT_URGENT_BITS  (REPORT_FALL_BIT)
+
+// Detection-to-POST-completion latency of urgent alerts
+typedef struct {
+    uint32_t count;
+    uint32_t last_us;
+    uint32_t max_us;
+    uint64_t total_us;
+} report_latency_t;
+
+// Function prototypes
+void report_init(void);
+void report_signal_fall(void);
+void report_signal_net_done(void);
+EventBits_t report_wait(TickType_t timeout);
+void report_complete_alert(void);
+void report_get_latency(report_latency_t *latency_out);
+
+#endif // REPORT_H
@@ -0,0 +1,65 @@
+#ifndef RETRY_H
+#define RETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// First backoff after a failure, doubling per consecutive failure up to RETRY_MAX_MS.
+// Each delay is jittered to between half and all of its nominal value.
+#define RETRY_BASE_MS       2000
+#define RETRY_MAX_MS        60000
+// Consecutive failures that open the circuit breaker
+#define RETRY_OPEN_AFTER    5
+// Time open before a single half-open probe, doubling on failed probes
+#define RETRY_OPEN_MS       300000
+#define RETRY_OPEN_MAX_MS   1800000
+
+typedef enum {
+    RETRY_CLOSED = 0,           // Attempts allowed, with backoff after failures
+    RETRY_OPEN,                 // Endpoint considered down, attempts refused
+    RETRY_HALF_OPEN,            // One probe in flight decides between the two
+} retry_state_t;
+
+typedef struct {
+    uint32_t attempts;          // Attempts let through
+    uint32_t successes;
+    uint32_t failures;
+    uint32_t refused;           // Attempts refused by backoff or an open breaker
+    uint32_t opens;             // Times the breaker opened
+} retry_stats_t;
+
+// One per remote endpoint, shared by every request to it
+typedef struct {
+    const char *name;
+    SemaphoreHandle_t lock;
+    retry_state_t state;
+    uint32_t consecutive_failures;
+    uint32_t open_ms;           // Current open period
+    int64_t next_attempt_us;    // No attempts before this
+    retry_stats_t stats;
+} retry_policy_t;
+
+// Policy state kept across deep sleep (see duty.h). Times are on the
+// uptime_us() timeline, which carries on across wakes.
+typedef struct {
+    retry_state_t state;
+    uint32_t consecutive_failures;
+    uint32_t open_ms;           // 0 if never saved
+    int64_t next_attempt_us;
+} retry_snapshot_t;
+
+// Function prototypes
+void retry_init(retry_policy_t *policy, const char *name);
+bool retry_begin(retry_policy_t *policy);
+void retry_end(retry_policy_t *policy, bool success);
+uint32_t retry_delay_ms(retry_policy_t *policy);
+retry_state_t retry_get_state(retry_policy_t *policy);
+void retry_get_stats(retry_policy_t *policy, retry_stats_t *stats_out);
+const char *retry_state_name(retry_state_t state);
+bool retry_http_status_failed(int status_code);
+void retry_save(retry_policy_t *policy, retry_snapshot_t *snapshot_out);
+void retry_restore(retry_policy_t *policy, const retry_snapshot_t *snapshot);
+
+#endif // RETRY_H
@@ -0,0 +1,45 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Periodic sensor work, woken by esp_timer at fixed deadlines
+// (start + phase + n * period) so the time spent working does not shift
+// later samples. Phases keep slow work like the DHT read off the IMU poll.
+typedef enum {
+    SAMPLER_IMU = 0,
+    SAMPLER_TEMP_HUM,
+    SAMPLER_LOG,
+    SAMPLER_NUM_SLOTS,
+} sampler_slot_t;
+
+#define SAMPLER_IMU_PERIOD_MS       50
+#define SAMPLER_IMU_PHASE_MS        0
+#define SAMPLER_TEMP_HUM_PERIOD_MS  2000
+#define SAMPLER_TEMP_HUM_PHASE_MS   25
+#define SAMPLER_LOG_PERIOD_MS       1000
+#define SAMPLER_LOG_PHASE_MS        500
+
+// Histogram of |actual interval - period| between consecutive wakes.
+// Upper bucket edges in microseconds, the last bucket is open-ended.
+#define SAMPLER_HIST_BUCKETS        8
+#define SAMPLER_HIST_EDGES_US       { 100, 500, 1000, 2000, 5000, 10000, 20000 }
+
+typedef struct {
+    uint32_t wakes;
+    uint32_t missed;            // Deadlines that passed while the task was still working
+    uint32_t overruns;          // Cycles whose work took longer than the period
+    uint32_t max_latency_us;    // Deadline to task running
+    uint32_t max_error_us;      // Worst interval error
+    uint32_t max_work_us;
+    uint32_t hist[SAMPLER_HIST_BUCKETS];
+} sampler_stats_t;
+
+// Function prototypes
+esp_err_t sampler_init(void);
+void sampler_wait(sampler_slot_t slot);
+void sampler_get_stats(sampler_slot_t slot, sampler_stats_t *stats_out);
+void sampler_log_report(void);
+
+#endif // SAMPLER_H
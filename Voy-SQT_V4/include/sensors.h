@@ -15,8 +15,15 @@ typedef struct {
     float humidity;
 } temp_hum_data_t;
 
+// Temperature/humidity event when a reading crosses H coming from below L
+#define TEMP_H_THRESHOLD 40
+#define TEMP_L_THRESHOLD 22
+#define HUM_H_THRESHOLD 45
+#define HUM_L_THRESHOLD 20
+
 // Function prototypes
 imu_data_t read_imu();
+void temp_hum_sensor_init();
 temp_hum_data_t read_temp_hum_sensor();
 
 #endif // SENSORS_H
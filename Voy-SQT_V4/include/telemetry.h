@@ -0,0 +1,19 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+// Event counters shared between the sensor tasks and the reporters
+typedef enum {
+    TELEMETRY_FALL = 0,
+    TELEMETRY_OVERTEMP,
+    TELEMETRY_OVERHUM,
+    TELEMETRY_NUM_COUNTERS,
+} telemetry_counter_t;
+
+// Function prototypes
+void telemetry_increment(telemetry_counter_t counter);
+uint32_t telemetry_peek(telemetry_counter_t counter);
+uint32_t telemetry_take(telemetry_counter_t counter);
+
+#endif // TELEMETRY_H
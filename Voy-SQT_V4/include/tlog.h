@@ -0,0 +1,81 @@
+#ifndef TLOG_H
+#define TLOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "batch.h"
+
+// Telemetry log partition, see partitions.csv
+#define TLOG_PARTITION_LABEL    "tlog"
+#define TLOG_PARTITION_SUBTYPE  0x40
+
+#define TLOG_SECTOR_SIZE        4096
+#define TLOG_RECORD_SIZE        32
+#define TLOG_RECORDS_PER_SECTOR (TLOG_SECTOR_SIZE / TLOG_RECORD_SIZE)
+
+// Drain rate cap: at most TLOG_DRAIN_BATCH records per request and one
+// request every TLOG_DRAIN_INTERVAL_MS (~1920 records/minute by default)
+#define TLOG_DRAIN_BATCH        64
+#define TLOG_DRAIN_INTERVAL_MS  2000
+// Encoded drain batch buffer, fits TLOG_DRAIN_BATCH worst-case records
+#define TLOG_BUFFER_SIZE        (TLOG_DRAIN_BATCH * 128 + 64)
+
+// On-flash record. Erased flash reads as 0xFF, so seq 0xFFFFFFFF is a free
+// slot and sent is cleared to 0 in place (no erase) once uploaded.
+typedef struct __attribute__((packed)) {
+    uint32_t seq;               // Monotonic across reboots
+    uint32_t uptime_ms;         // uptime_us() within the boot it was written in
+    uint16_t boot;
+    uint8_t flags;              // TLOG_FLAG_*
+    uint8_t fall_events;        // Counts saturate instead of wrapping
+    uint16_t overtemp_events;
+    uint16_t overhum_events;
+    int32_t longitude_e6;       // Degrees * 1e6
+    int32_t latitude_e6;
+    uint32_t crc;               // CRC32 of all fields above
+    uint32_t sent;              // 0xFFFFFFFF until acknowledged by the backend
+} tlog_record_t;
+
+#define TLOG_FLAG_LOCATION      0x01
+
+typedef struct {
+    uint32_t capacity;          // Record slots in the partition
+    uint32_t pending;           // Records waiting to be uploaded
+    uint32_t appended;          // Records written since boot
+    uint32_t drained;           // Records acknowledged since boot
+    uint32_t rejected;          // Records the backend refused, dropped unsent
+    uint32_t dropped;           // Unsent records overwritten by the log wrapping
+    uint32_t corrupt;           // Records skipped on a bad CRC
+} tlog_stats_t;
+
+// Ring position kept across deep sleep (see duty.h) so a wake does not
+// rescan the whole partition
+typedef struct {
+    uint32_t capacity;          // 0 if never saved
+    uint32_t head;
+    uint32_t tail;
+    uint32_t next_seq;
+    uint32_t pending;
+    uint16_t boot;
+} tlog_cursor_t;
+
+// Function prototypes
+esp_err_t tlog_init(void);
+esp_err_t tlog_resume(const tlog_cursor_t *cursor);
+void tlog_save_cursor(tlog_cursor_t *cursor_out);
+esp_err_t tlog_append(const batch_record_t *record);
+uint32_t tlog_pending(void);
+bool tlog_should_drain(void);
+size_t tlog_encode_json(char *buf, size_t buf_len);
+size_t tlog_encode_cbor(uint8_t *buf, size_t buf_len);
+size_t tlog_encode_legacy(char *buf, size_t buf_len);
+size_t tlog_encode(uint8_t *buf, size_t buf_len);
+void tlog_commit(void);
+void tlog_reject(void);
+void tlog_abort(void);
+uint32_t tlog_encoded_falls(void);
+void tlog_get_stats(tlog_stats_t *stats_out);
+
+#endif // TLOG_H
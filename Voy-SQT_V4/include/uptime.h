@@ -0,0 +1,14 @@
+#ifndef UPTIME_H
+#define UPTIME_H
+
+#include <stdint.h>
+
+// Monotonic time base for telemetry timestamps and ages. Normally the same
+// as esp_timer_get_time(). Deep sleep resets esp_timer, so duty cycle mode
+// (duty.h) sets a base carried in RTC memory to keep one timeline across wakes.
+
+// Function prototypes
+int64_t uptime_us(void);
+void uptime_set_base(int64_t base_us);
+
+#endif // UPTIME_H
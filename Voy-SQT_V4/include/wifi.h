@@ -1,6 +1,7 @@
 #ifndef WIFI_H
 #define WIFI_H
 
+#include <stdint.h>
 #include "driver/gpio.h"
 #include "esp_event.h"
 
@@ -8,11 +9,37 @@
 #define WIFI_SSID        "Lumio-Dev"
 #define WIFI_PASS        "omsohamom"
 #define WIFI_HOSTNAME    "SQT-2808"
-#define MAX_WIFI_RETRY   5
+
+// Reconnect backoff after a failed full scan, doubling up to the max.
+// The connection manager never gives up.
+#define WIFI_BACKOFF_MIN_MS   1000
+#define WIFI_BACKOFF_MAX_MS   60000
+// Last good AP, tried first on a single channel before scanning them all
+#define WIFI_NVS_NAMESPACE    "wifi_cm"
+
+// Connection manager events, posted to the default event loop so all
+// connection state is handled by the same task as the WiFi events
+ESP_EVENT_DECLARE_BASE(WIFI_CM_EVENT);
+
+typedef enum {
+    WIFI_CM_EVENT_RECONNECT,        // Backoff expired, start the next attempt
+} wifi_cm_event_t;
+
+typedef struct {
+    uint32_t cold_boot_ms;          // wifi_init_sta() to the first IP, 0 until then
+    uint32_t last_reconnect_ms;     // Disconnect to IP for the most recent reconnect
+    uint32_t max_reconnect_ms;
+    uint64_t total_reconnect_ms;
+    uint32_t reconnects;            // Completed reconnects after losing the link
+    uint32_t disconnects;
+    uint32_t fast_connects;         // Connects that used the cached BSSID and channel
+    uint32_t full_scans;            // Connect attempts that scanned every channel
+} wifi_stats_t;
 
 // Function Prototypes
 static void wifi_event_handler(void* arg, esp_event_base_t event_base,
     int32_t event_id, void* event_data);
 void wifi_init_sta(void);
+void wifi_get_stats(wifi_stats_t *stats_out);
 
 #endif // WIFI_H
@@ -0,0 +1,40 @@
+#ifndef WIFI_SCAN_H
+#define WIFI_SCAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_wifi.h"
+
+// Per-channel dwell. Shorter dwell means less radio-on time per scan and
+// less time away from the AP we are connected to, at the cost of missing
+// weak or slow-beaconing APs.
+#define WIFI_SCAN_PASSIVE         0       // 1: listen for beacons, never transmit probes
+#define WIFI_SCAN_ACTIVE_MIN_MS   30
+#define WIFI_SCAN_ACTIVE_MAX_MS   60
+#define WIFI_SCAN_PASSIVE_MS      110     // Just over the usual 102.4 ms beacon interval
+// Time back on the home channel between scanned channels while connected
+#define WIFI_SCAN_HOME_DWELL_MS   30
+
+// Records pulled from the driver per scan, strongest WIFI_SCAN_MAX_APS kept
+#define WIFI_SCAN_MAX_RECORDS     32
+#define WIFI_SCAN_NUM_CHANNELS    13
+// Scan only channels APs were seen on, with a full sweep every Nth scan
+// or when the learned channels come back short of APs
+#define WIFI_SCAN_FULL_EVERY      8
+
+typedef struct {
+    uint32_t scans;
+    uint32_t full_scans;            // Scans over every channel
+    uint32_t last_ms;               // Duration of the last scan
+    uint32_t max_ms;
+    uint64_t total_ms;
+    uint16_t last_seen;             // APs reported by the driver in the last scan
+    uint16_t learned_channels;      // Bitmap, BIT(channel)
+} wifi_scan_stats_t;
+
+// Function prototypes
+size_t wifi_scan_strongest(wifi_ap_record_t *best, size_t max_aps);
+void wifi_scan_get_stats(wifi_scan_stats_t *stats_out);
+
+#endif // WIFI_SCAN_H
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "batch.h"
+#include "tlog.h"
+#include "cbor.h"
+#include "uptime.h"
+
+static const char *TAG = "batch";
+
+// Bounded FIFO of records waiting to be sent, oldest first
+static batch_record_t records[BATCH_MAX_RECORDS];
+static size_t head = 0;
+static size_t count = 0;
+
+// Number of records covered by the last encode, removed on commit
+static size_t encoded_count = 0;
+
+static batch_stats_t stats;
+
+// Only called from the uploader task
+void batch_add(const batch_record_t *record) {
+    if (stats.since_us == 0) {
+        stats.since_us = uptime_us();
+    }
+    if (count == BATCH_MAX_RECORDS) {
+        // Full. The first encoded_count records belong to the batch in flight
+        // and are removed by batch_commit(), so they cannot leave the queue
+        // now. Move the oldest record after them to flash (or drop it)...
+        if (encoded_count < count) {
+            size_t victim = (head + encoded_count) % BATCH_MAX_RECORDS;
+            if (tlog_append(&records[victim]) == ESP_OK) {
+                stats.spilled++;
+            } else {
+                stats.dropped++;
+            }
+            for (size_t i = encoded_count; i + 1 < count; i++) {
+                records[(head + i) % BATCH_MAX_RECORDS] = records[(head + i + 1) % BATCH_MAX_RECORDS];
+            }
+            count--;
+        } else {
+            // ...or, with the whole queue in flight, the new record itself
+            if (tlog_append(record) == ESP_OK) {
+                stats.spilled++;
+            } else {
+                stats.dropped++;
+            }
+            return;
+        }
+    }
+    records[(head + count) % BATCH_MAX_RECORDS] = *record;
+    count++;
+}
+
+size_t batch_count(void) {
+    return count;
+}
+
+// Flush on priority, size or age
+bool batch_should_flush(bool urgent) {
+    if (count == 0) {
+        return false;
+    }
+    if (urgent || count >= BATCH_MAX_RECORDS) {
+        return true;
+    }
+    int64_t age_us = uptime_us() - records[head].timestamp_us;
+    return age_us >= (int64_t)BATCH_MAX_AGE_MS * 1000;
+}
+
+// Encode as many queued records as fit into one JSON array. Timestamps are
+// sent as an age in ms because the device has no wall clock.
+size_t batch_encode_json(char *buf, size_t buf_len) {
+    int64_t now = uptime_us();
+    size_t len = snprintf(buf, buf_len, "{\"uid\":%d,\"events\":[", 2808);
+    encoded_count = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const batch_record_t *r = &records[(head + i) % BATCH_MAX_RECORDS];
+        char item[160];
+        int n;
+        if (r->has_location) {
+            n = snprintf(item, sizeof(item), "%s{\"age\":%lld,\"fall\":%d,\"temp\":%d,\"hum\":%d,\"long\":%.6f,\"lat\":%.6f}",
+                         i ? "," : "", (long long)((now - r->timestamp_us) / 1000), r->fall_events, r->overtemp_events,
+                         r->overhum_events, r->longitude, r->latitude);
+        } else {
+            n = snprintf(item, sizeof(item), "%s{\"age\":%lld,\"fall\":%d,\"temp\":%d,\"hum\":%d}",
+                         i ? "," : "", (long long)((now - r->timestamp_us) / 1000), r->fall_events, r->overtemp_events,
+                         r->overhum_events);
+        }
+        // Keep room for the closing "]}"
+        if (n < 0 || len + n + 3 > buf_len) {
+            break;
+        }
+        memcpy(buf + len, item, n);
+        len += n;
+        encoded_count++;
+    }
+
+    memcpy(buf + len, "]}", 3);
+    return len + 2;
+}
+
+// Same records as batch_encode_json, as a CBOR map with an indefinite
+// "events" array. Counts and ages are small integers, so most records are
+// well under half their JSON size.
+size_t batch_encode_cbor(uint8_t *buf, size_t buf_len) {
+    int64_t now = uptime_us();
+    cbor_writer_t w;
+    encoded_count = 0;
+
+    // Hold back one byte for the break that closes the array
+    cbor_writer_init(&w, buf, buf_len - 1);
+    cbor_start_map(&w, 2);
+    cbor_put_text(&w, "uid");
+    cbor_put_uint(&w, 2808);
+    cbor_put_text(&w, "events");
+    cbor_start_indefinite_array(&w);
+    if (w.overflow) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const batch_record_t *r = &records[(head + i) % BATCH_MAX_RECORDS];
+        size_t mark = w.len;
+        cbor_start_map(&w, r->has_location ? 6 : 4);
+        cbor_put_text(&w, "age");
+        cbor_put_int(&w, (now - r->timestamp_us) / 1000);
+        cbor_put_text(&w, "fall");
+        cbor_put_int(&w, r->fall_events);
+        cbor_put_text(&w, "temp");
+        cbor_put_int(&w, r->overtemp_events);
+        cbor_put_text(&w, "hum");
+        cbor_put_int(&w, r->overhum_events);
+        if (r->has_location) {
+            cbor_put_text(&w, "long");
+            cbor_put_float(&w, (float)r->longitude);
+            cbor_put_text(&w, "lat");
+            cbor_put_float(&w, (float)r->latitude);
+        }
+        if (w.overflow) {
+            cbor_rollback(&w, mark);
+            break;
+        }
+        encoded_count++;
+    }
+
+    w.cap = buf_len;
+    cbor_end_indefinite(&w);
+    return w.len;
+}
+
+// Oldest queued record alone, in the schema of the single-record endpoint.
+// It has no timestamp, the backend stamps records on arrival.
+size_t batch_encode_legacy(char *buf, size_t buf_len) {
+    encoded_count = 0;
+    if (count == 0) {
+        return 0;
+    }
+
+    const batch_record_t *r = &records[head];
+    int n = snprintf(buf, buf_len, "{\"uid\":%d, \"long\":%f, \"lat\":%f, \"fall\":%d, \"temp\":%d, \"hum\":%d}",
+                     2808, r->has_location ? r->longitude : 0.0, r->has_location ? r->latitude : 0.0,
+                     r->fall_events, r->overtemp_events, r->overhum_events);
+    if (n < 0 || (size_t)n >= buf_len) {
+        return 0;
+    }
+    encoded_count = 1;
+    return n;
+}
+
+// Encode in BATCH_FORMAT, send with batch_content_type()
+size_t batch_encode(uint8_t *buf, size_t buf_len) {
+#if BATCH_FORMAT == BATCH_FORMAT_CBOR
+    return batch_encode_cbor(buf, buf_len);
+#elif BATCH_FORMAT == BATCH_FORMAT_LEGACY
+    return batch_encode_legacy((char *)buf, buf_len);
+#else
+    return batch_encode_json((char *)buf, buf_len);
+#endif
+}
+
+const char *batch_content_type(void) {
+#if BATCH_FORMAT == BATCH_FORMAT_CBOR
+    return "application/cbor";
+#else
+    return "application/json";
+#endif
+}
+
+// The last encoded batch was delivered, drop its records
+void batch_commit(size_t sent_bytes) {
+    head = (head + encoded_count) % BATCH_MAX_RECORDS;
+    count -= encoded_count;
+    stats.events += encoded_count;
+    stats.requests++;
+    stats.bytes += sent_bytes;
+    encoded_count = 0;
+}
+
+// The backend answered but refused the last encoded batch (a 4xx other than
+// 429). Resending or spilling it would get the same answer, drop it.
+void batch_reject(void) {
+    ESP_LOGW(TAG, "Backend rejected %u records, dropping them", (unsigned)encoded_count);
+    head = (head + encoded_count) % BATCH_MAX_RECORDS;
+    count -= encoded_count;
+    stats.rejected += encoded_count;
+    encoded_count = 0;
+}
+
+// Upload failed, move everything queued to the flash log so it survives
+// a reboot and is drained once the backend is reachable again
+void batch_spill(void) {
+    while (count > 0) {
+        if (tlog_append(&records[head]) != ESP_OK) {
+            // No flash log, keep the records in RAM and retry later
+            break;
+        }
+        head = (head + 1) % BATCH_MAX_RECORDS;
+        count--;
+        stats.spilled++;
+    }
+    encoded_count = 0;
+}
+
+// Fall events among the records of the last encoded batch
+int batch_encoded_falls(void) {
+    int falls = 0;
+    for (size_t i = 0; i < encoded_count; i++) {
+        falls += records[(head + i) % BATCH_MAX_RECORDS].fall_events;
+    }
+    return falls;
+}
+
+void batch_get_stats(batch_stats_t *stats_out) {
+    *stats_out = stats;
+}
+
+void batch_log_stats(void) {
+    if (stats.events == 0) {
+        return;
+    }
+    int64_t elapsed_s = (uptime_us() - stats.since_us) / 1000000;
+    ESP_LOGI(TAG, "%lu events in %lu requests, %lu bytes/event, %lu requests/hour, %lu dropped, %lu rejected",
+             (unsigned long)stats.events, (unsigned long)stats.requests,
+             (unsigned long)(stats.bytes / stats.events),
+             (unsigned long)(elapsed_s > 0 ? (int64_t)stats.requests * 3600 / elapsed_s : stats.requests),
+             (unsigned long)stats.dropped, (unsigned long)stats.rejected);
+}
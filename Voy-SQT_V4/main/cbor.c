@@ -0,0 +1,128 @@
+#include <string.h>
+#include "cbor.h"
+
+#define CBOR_UINT       0
+#define CBOR_NEGINT     1
+#define CBOR_TEXT       3
+#define CBOR_ARRAY      4
+#define CBOR_MAP        5
+
+#define CBOR_FALSE      0xf4
+#define CBOR_TRUE       0xf5
+#define CBOR_FLOAT32    0xfa
+#define CBOR_INDEFINITE 0x1f
+#define CBOR_BREAK      0xff
+
+static bool reserve(cbor_writer_t *w, size_t n) {
+    if (w->overflow || w->cap - w->len < n) {
+        w->overflow = true;
+        return false;
+    }
+    return true;
+}
+
+// Initial byte plus the shortest big-endian argument that holds value
+static void put_head(cbor_writer_t *w, uint8_t major, uint64_t value) {
+    uint8_t head[9];
+    size_t n;
+
+    if (value < 24) {
+        head[0] = (major << 5) | (uint8_t)value;
+        n = 1;
+    } else if (value <= UINT8_MAX) {
+        head[0] = (major << 5) | 24;
+        n = 2;
+    } else if (value <= UINT16_MAX) {
+        head[0] = (major << 5) | 25;
+        n = 3;
+    } else if (value <= UINT32_MAX) {
+        head[0] = (major << 5) | 26;
+        n = 5;
+    } else {
+        head[0] = (major << 5) | 27;
+        n = 9;
+    }
+    for (size_t i = 1; i < n; i++) {
+        head[i] = (uint8_t)(value >> (8 * (n - 1 - i)));
+    }
+
+    if (reserve(w, n)) {
+        memcpy(w->buf + w->len, head, n);
+        w->len += n;
+    }
+}
+
+static void put_byte(cbor_writer_t *w, uint8_t byte) {
+    if (reserve(w, 1)) {
+        w->buf[w->len++] = byte;
+    }
+}
+
+void cbor_writer_init(cbor_writer_t *w, uint8_t *buf, size_t cap) {
+    w->buf = buf;
+    w->cap = cap;
+    w->len = 0;
+    w->overflow = false;
+}
+
+// Drop everything written after len and clear the overflow flag
+void cbor_rollback(cbor_writer_t *w, size_t len) {
+    w->len = len;
+    w->overflow = false;
+}
+
+void cbor_put_uint(cbor_writer_t *w, uint64_t value) {
+    put_head(w, CBOR_UINT, value);
+}
+
+void cbor_put_int(cbor_writer_t *w, int64_t value) {
+    if (value >= 0) {
+        put_head(w, CBOR_UINT, (uint64_t)value);
+    } else {
+        put_head(w, CBOR_NEGINT, (uint64_t)(-1 - value));
+    }
+}
+
+void cbor_put_text(cbor_writer_t *w, const char *text) {
+    size_t n = strlen(text);
+    put_head(w, CBOR_TEXT, n);
+    if (reserve(w, n)) {
+        memcpy(w->buf + w->len, text, n);
+        w->len += n;
+    }
+}
+
+// Single precision is ~1 m at the largest longitudes, well inside WiFi
+// geolocation accuracy, and half the size of a double
+void cbor_put_float(cbor_writer_t *w, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if (reserve(w, 5)) {
+        w->buf[w->len++] = CBOR_FLOAT32;
+        w->buf[w->len++] = (uint8_t)(bits >> 24);
+        w->buf[w->len++] = (uint8_t)(bits >> 16);
+        w->buf[w->len++] = (uint8_t)(bits >> 8);
+        w->buf[w->len++] = (uint8_t)bits;
+    }
+}
+
+void cbor_put_bool(cbor_writer_t *w, bool value) {
+    put_byte(w, value ? CBOR_TRUE : CBOR_FALSE);
+}
+
+void cbor_start_map(cbor_writer_t *w, size_t pairs) {
+    put_head(w, CBOR_MAP, pairs);
+}
+
+void cbor_start_array(cbor_writer_t *w, size_t items) {
+    put_head(w, CBOR_ARRAY, items);
+}
+
+// For arrays whose length is only known once the buffer fills up
+void cbor_start_indefinite_array(cbor_writer_t *w) {
+    put_byte(w, (CBOR_ARRAY << 5) | CBOR_INDEFINITE);
+}
+
+void cbor_end_indefinite(cbor_writer_t *w) {
+    put_byte(w, CBOR_BREAK);
+}
@@ -0,0 +1,311 @@
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "esp_attr.h"
+#include "esp_wifi.h"
+#include "nvs_flash.h"
+#include "duty.h"
+#include "sensors.h"
+#include "imu_adc.h"
+#include "fall_detector.h"
+#include "batch.h"
+#include "tlog.h"
+#include "http.h"
+#include "wifi.h"
+#include "geolocation.h"
+#include "loc_cache.h"
+#include "retry.h"
+#include "uptime.h"
+
+static const char *TAG = "duty";
+
+#define DUTY_MAGIC 0x44555459
+
+extern EventGroupHandle_t wifi_event_group;
+
+// Survives deep sleep, lost on power loss or reset
+typedef struct {
+    uint32_t magic;
+    uint32_t cycles_since_upload;
+    int fall_events;
+    int overtemp_events;
+    int overhum_events;
+    temp_hum_data_t last_env;
+    int32_t rest_mg[3];         // Mean gravity vector of the last burst
+    bool moved;                 // Since the last location fix
+    bool has_location;
+    double longitude;
+    double latitude;
+    tlog_cursor_t tlog_cursor;
+    int64_t time_base_us;       // uptime_us() at the start of this wake
+    retry_snapshot_t backend_link;  // Backoff and breaker of backend_retry
+    retry_snapshot_t geo_link;      // and of geo_retry
+    duty_stats_t stats;
+} duty_state_t;
+
+static RTC_DATA_ATTR duty_state_t rtc_state;
+
+// Accelerometer burst, filled from the acquisition task
+static fall_detector_t detector;
+static int64_t axis_sum[3];
+static uint32_t burst_samples;
+static int burst_falls;
+
+static void duty_on_frame(const imu_frame_t *frame, void *arg) {
+    for (size_t i = 0; i < frame->num_samples; i++) {
+        imu_sample_t sample = {
+            .timestamp_us = (uint32_t)(frame->timestamp_us + (int64_t)i * frame->sample_period_us),
+            .x = frame->samples[i].x,
+            .y = frame->samples[i].y,
+            .z = frame->samples[i].z,
+        };
+        fall_event_t event;
+        if (fall_detector_update(&detector, &sample, &event)) {
+            burst_falls++;
+        }
+        axis_sum[0] += sample.x;
+        axis_sum[1] += sample.y;
+        axis_sum[2] += sample.z;
+        burst_samples++;
+    }
+}
+
+// Short accelerometer burst: falls caught inside it, and whether the resting
+// orientation changed since the last wake. Falls while asleep are missed.
+static void sample_imu(void) {
+    fall_detector_config_t config;
+    fall_detector_default_config(&config);
+    fall_detector_init(&detector, &config);
+    memset(axis_sum, 0, sizeof(axis_sum));
+    burst_samples = 0;
+    burst_falls = 0;
+
+    imu_adc_config_t imu_config = {
+        .sample_rate_hz = IMU_ADC_DEFAULT_RATE_HZ,
+        .on_frame = duty_on_frame,
+    };
+    if (imu_adc_start(&imu_config) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start IMU sampling");
+        return;
+    }
+    vTaskDelay(pdMS_TO_TICKS(DUTY_IMU_BURST_MS));
+    imu_adc_stop();
+
+    if (burst_samples == 0) {
+        return;
+    }
+    int32_t delta = 0;
+    for (int i = 0; i < 3; i++) {
+        int32_t mg = (int32_t)((axis_sum[i] / burst_samples - config.zero_g_counts[i]) * 1000 / config.counts_per_g);
+        delta += mg > rtc_state.rest_mg[i] ? mg - rtc_state.rest_mg[i] : rtc_state.rest_mg[i] - mg;
+        rtc_state.rest_mg[i] = mg;
+    }
+    if (delta >= DUTY_MOVED_MG) {
+        rtc_state.moved = true;
+        // Report in on the first wake
+        rtc_state.cycles_since_upload = DUTY_UPLOAD_EVERY - 1;
+    }
+    rtc_state.fall_events += burst_falls;
+}
+
+// Same edge rules as temp_hum_sensor_task, against the reading from the last wake
+static bool sample_env(void) {
+    temp_hum_data_t now = read_temp_hum_sensor();
+    bool alert = false;
+    if (now.temperature > TEMP_H_THRESHOLD && rtc_state.last_env.temperature < TEMP_L_THRESHOLD) {
+        rtc_state.overtemp_events++;
+        alert = true;
+    }
+    if (now.humidity > HUM_H_THRESHOLD && rtc_state.last_env.humidity < HUM_L_THRESHOLD) {
+        rtc_state.overhum_events++;
+        alert = true;
+    }
+    rtc_state.last_env = now;
+    return alert;
+}
+
+// Refresh the location after the package moved, from the cache if possible
+static void update_location(void) {
+    size_t num_aps = 0;
+    wifi_ap_t *wifi_aps = create_wifi_aps_array(&num_aps);
+    if (wifi_aps == NULL) {
+        return;
+    }
+
+    loc_fingerprint_t fingerprint = {0};
+    for (size_t i = 0; i < num_aps; i++) {
+        loc_fingerprint_add(&fingerprint, wifi_aps[i].mac, wifi_aps[i].signal_strength);
+    }
+
+    long_lat_t loc;
+    bool found = loc_cache_lookup(&fingerprint, &loc.latitude, &loc.longitude, &loc.accuracy);
+    if (!found) {
+        static wifi_scan_json_t scan;
+        scan.len = generate_wifi_scan_json(wifi_aps, num_aps, scan.json, sizeof(scan.json));
+        found = scan.len > 0 && process_geolocation_json(scan.json, scan.len, &loc);
+        if (found) {
+            loc_cache_insert(&fingerprint, loc.latitude, loc.longitude, loc.accuracy);
+        }
+    }
+    free(wifi_aps);
+
+    if (found) {
+        rtc_state.has_location = true;
+        rtc_state.longitude = loc.longitude;
+        rtc_state.latitude = loc.latitude;
+        rtc_state.moved = false;
+    }
+}
+
+// Bring WiFi up, send the record and one backlog batch.
+// Anything that cannot be sent goes to the flash log.
+static void upload_online(batch_record_t *record) {
+    wifi_init_sta();
+    EventBits_t bits = xEventGroupWaitBits(wifi_event_group, BIT0, pdFALSE, pdTRUE,
+                                           pdMS_TO_TICKS(DUTY_WIFI_TIMEOUT_MS));
+    if (!(bits & BIT0)) {
+        ESP_LOGW(TAG, "No WiFi, storing to flash");
+        tlog_append(record);
+    } else {
+        if (rtc_state.moved || !rtc_state.has_location) {
+            update_location();
+            record->has_location = rtc_state.has_location;
+            record->longitude = rtc_state.longitude;
+            record->latitude = rtc_state.latitude;
+        }
+
+        static uint8_t buf[TLOG_BUFFER_SIZE > BATCH_BUFFER_SIZE ? TLOG_BUFFER_SIZE : BATCH_BUFFER_SIZE];
+        batch_add(record);
+        size_t len = batch_encode(buf, sizeof(buf));
+        esp_err_t err = send_batch_request(buf, len, batch_content_type());
+        if (err == ESP_OK) {
+            batch_commit(len);
+            rtc_state.stats.uploads++;
+        } else if (err == ESP_ERR_INVALID_RESPONSE) {
+            batch_reject();
+        } else {
+            batch_spill();
+        }
+
+        if (tlog_should_drain()) {
+            len = tlog_encode(buf, sizeof(buf));
+            err = len > 0 ? send_batch_request(buf, len, batch_content_type()) : ESP_FAIL;
+            if (err == ESP_OK) {
+                tlog_commit();
+            } else if (err == ESP_ERR_INVALID_RESPONSE) {
+                tlog_reject();
+            } else {
+                tlog_abort();
+            }
+        }
+    }
+    esp_wifi_stop();
+}
+
+// Send the accumulated counters, or store them while the backend is down
+static void upload(void) {
+    batch_record_t record = {
+        .timestamp_us = uptime_us(),
+        .fall_events = rtc_state.fall_events,
+        .overtemp_events = rtc_state.overtemp_events,
+        .overhum_events = rtc_state.overhum_events,
+        .has_location = rtc_state.has_location,
+        .longitude = rtc_state.longitude,
+        .latitude = rtc_state.latitude,
+    };
+
+    // Still backing off from an earlier wake, do not power the radio for it
+    if (retry_delay_ms(&backend_retry) > 0) {
+        ESP_LOGI(TAG, "Backend %s, storing to flash", retry_state_name(retry_get_state(&backend_retry)));
+        tlog_append(&record);
+    } else {
+        upload_online(&record);
+    }
+
+    // Counters are either acknowledged or in the flash log now
+    rtc_state.fall_events = 0;
+    rtc_state.overtemp_events = 0;
+    rtc_state.overhum_events = 0;
+    rtc_state.cycles_since_upload = 0;
+}
+
+// Runs instead of the always-on tasks when DUTY_CYCLE_MODE is set. Never
+// returns, every wake ends in deep sleep.
+void duty_cycle_task(void *pvParameter) {
+    bool warm = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER && rtc_state.magic == DUTY_MAGIC;
+    if (!warm) {
+        memset(&rtc_state, 0, sizeof(rtc_state));
+        rtc_state.magic = DUTY_MAGIC;
+        rtc_state.last_env.temperature = 25.0;
+        rtc_state.last_env.humidity = 25.0;
+        rtc_state.moved = true;
+        // Report in on the first wake
+        rtc_state.cycles_since_upload = DUTY_UPLOAD_EVERY - 1;
+        ESP_LOGI(TAG, "Cold boot, duty cycle every %d s", DUTY_SLEEP_S);
+    } else {
+        rtc_state.stats.cycles++;
+        ESP_LOGI(TAG, "Wake %lu, last cycle awake %lu ms", (unsigned long)rtc_state.stats.cycles,
+                 (unsigned long)rtc_state.stats.last_awake_ms);
+    }
+
+    // Continue the timeline of earlier wakes, records are stamped from it
+    uptime_set_base(rtc_state.time_base_us);
+
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+
+    // A warm wake picks the flash log up from RTC memory instead of scanning it
+    if (warm) {
+        tlog_resume(&rtc_state.tlog_cursor);
+    } else {
+        tlog_init();
+    }
+    loc_cache_init();
+    retry_init(&backend_retry, "backend");
+    retry_init(&geo_retry, "geolocation");
+    retry_restore(&backend_retry, &rtc_state.backend_link);
+    retry_restore(&geo_retry, &rtc_state.geo_link);
+
+    temp_hum_sensor_init();
+    bool alert = sample_env();
+    int falls_before = rtc_state.fall_events;
+    sample_imu();
+    alert |= rtc_state.fall_events != falls_before;
+
+    rtc_state.cycles_since_upload++;
+    if (alert || rtc_state.cycles_since_upload >= DUTY_UPLOAD_EVERY) {
+        upload();
+    }
+
+    tlog_save_cursor(&rtc_state.tlog_cursor);
+    retry_save(&backend_retry, &rtc_state.backend_link);
+    retry_save(&geo_retry, &rtc_state.geo_link);
+
+    uint32_t awake_ms = esp_timer_get_time() / 1000;
+    rtc_state.stats.last_awake_ms = awake_ms;
+    rtc_state.stats.total_awake_ms += awake_ms;
+    if (awake_ms > rtc_state.stats.max_awake_ms) {
+        rtc_state.stats.max_awake_ms = awake_ms;
+    }
+    ESP_LOGI(TAG, "Awake %lu ms, sleeping %d s", (unsigned long)awake_ms, DUTY_SLEEP_S);
+
+    // The next wake starts after this one plus the sleep. Boot time before
+    // esp_timer starts is not counted, so the base runs slightly slow.
+    rtc_state.time_base_us = uptime_us() + (int64_t)DUTY_SLEEP_S * 1000000;
+
+    esp_sleep_enable_timer_wakeup((uint64_t)DUTY_SLEEP_S * 1000000);
+    esp_deep_sleep_start();
+}
+
+void duty_get_stats(duty_stats_t *stats_out) {
+    *stats_out = rtc_state.stats;
+}
@@ -0,0 +1,105 @@
+#include <string.h>
+#include "esp_timer.h"
+#include "event_bus.h"
+
+#define EVENT_BUS_MASK (EVENT_BUS_CAPACITY - 1)
+#define EVENT_BUS_MAX_NOTIFY 4
+
+static event_t ring[EVENT_BUS_CAPACITY];
+static uint32_t next_seq = 0;
+
+// Events ever published per type, so a lapped subscriber can tell how many
+// of the overwritten events were ones it wanted
+static uint32_t published[EVENT_NUM_TYPES];
+
+// Held only for a single event copy, never across a blocking call
+static portMUX_TYPE bus_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static event_sub_t *notify_subs[EVENT_BUS_MAX_NOTIFY];
+static size_t num_notify_subs = 0;
+
+// Never blocks: the oldest event is overwritten when the ring is full
+void event_bus_publish(event_type_t type, const event_t *payload) {
+    event_t event;
+    if (payload) {
+        event = *payload;
+    } else {
+        memset(&event, 0, sizeof(event));
+    }
+    event.type = type;
+    event.timestamp_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&bus_mux);
+    event.seq = next_seq++;
+    ring[event.seq & EVENT_BUS_MASK] = event;
+    published[type]++;
+    portEXIT_CRITICAL(&bus_mux);
+
+    for (size_t i = 0; i < num_notify_subs; i++) {
+        if (notify_subs[i]->mask & EVENT_MASK(type)) {
+            xTaskNotifyGive(notify_subs[i]->notify);
+        }
+    }
+}
+
+// Matching events published so far. Call with bus_mux held.
+static uint32_t count_published(uint32_t mask) {
+    uint32_t total = 0;
+    for (int type = 0; type < EVENT_NUM_TYPES; type++) {
+        if (mask & EVENT_MASK(type)) {
+            total += published[type];
+        }
+    }
+    return total;
+}
+
+// Subscribers only see events published after they subscribe
+void event_bus_subscribe(event_sub_t *sub, uint32_t mask, TaskHandle_t notify) {
+    portENTER_CRITICAL(&bus_mux);
+    sub->cursor = next_seq;
+    sub->mask = mask;
+    sub->overflows = 0;
+    sub->passed = count_published(mask);
+    sub->notify = notify;
+    if (notify && num_notify_subs < EVENT_BUS_MAX_NOTIFY) {
+        notify_subs[num_notify_subs++] = sub;
+    }
+    portEXIT_CRITICAL(&bus_mux);
+}
+
+// Returns the next event matching the subscriber's mask, false if none pending
+bool event_bus_read(event_sub_t *sub, event_t *event_out) {
+    while (1) {
+        portENTER_CRITICAL(&bus_mux);
+        uint32_t pending = next_seq - sub->cursor;
+        if (pending == 0) {
+            portEXIT_CRITICAL(&bus_mux);
+            return false;
+        }
+        if (pending > EVENT_BUS_CAPACITY) {
+            // Lapped: the matching events before the oldest one still in the
+            // ring are the published ones minus those left in the ring
+            sub->cursor = next_seq - EVENT_BUS_CAPACITY;
+            uint32_t retained = 0;
+            for (uint32_t i = 0; i < EVENT_BUS_CAPACITY; i++) {
+                if (sub->mask & EVENT_MASK(ring[i].type)) {
+                    retained++;
+                }
+            }
+            uint32_t before_cursor = count_published(sub->mask) - retained;
+            sub->overflows += before_cursor - sub->passed;
+            sub->passed = before_cursor;
+        }
+        *event_out = ring[sub->cursor & EVENT_BUS_MASK];
+        sub->cursor++;
+        bool match = sub->mask & EVENT_MASK(event_out->type);
+        if (match) {
+            sub->passed++;
+        }
+        portEXIT_CRITICAL(&bus_mux);
+
+        if (match) {
+            return true;
+        }
+    }
+}
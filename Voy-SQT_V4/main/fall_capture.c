@@ -0,0 +1,110 @@
+#include <string.h>
+#include "esp_log.h"
+#include "fall_capture.h"
+
+static const char *TAG = "fall_capture";
+
+QueueHandle_t fall_capture_queue = NULL;
+
+#define HISTORY_MASK (FALL_CAPTURE_HISTORY - 1)
+
+// Zigzag-map a signed delta and write it as a little-endian base-128 varint
+static size_t put_delta(uint8_t *out, int32_t delta) {
+    uint32_t v = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+void fall_capture_init(fall_capture_t *cap) {
+    memset(cap, 0, sizeof(*cap));
+    for (int i = 0; i < FALL_CAPTURE_SLOTS; i++) {
+        atomic_init(&cap->slots[i].in_use, false);
+    }
+    if (fall_capture_queue == NULL) {
+        fall_capture_queue = xQueueCreate(FALL_CAPTURE_SLOTS, sizeof(fall_capture_blob_t *));
+    }
+}
+
+static fall_capture_blob_t *claim_slot(fall_capture_t *cap) {
+    for (int i = 0; i < FALL_CAPTURE_SLOTS; i++) {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&cap->slots[i].in_use, &expected, true)) {
+            return &cap->slots[i];
+        }
+    }
+    return NULL;
+}
+
+// Encode the whole history ring (oldest first) into a free slot and queue it
+static void seal_capture(fall_capture_t *cap) {
+    fall_capture_blob_t *blob = claim_slot(cap);
+    if (blob == NULL) {
+        cap->dropped++;
+        ESP_LOGW(TAG, "No free capture slot, dropping waveform");
+        return;
+    }
+
+    uint32_t count = cap->head < FALL_CAPTURE_HISTORY ? cap->head : FALL_CAPTURE_HISTORY;
+    uint32_t first = cap->head - count;
+    const imu_sample_t *oldest = &cap->history[first & HISTORY_MASK];
+    const imu_sample_t *newest = &cap->history[(cap->head - 1) & HISTORY_MASK];
+
+    fall_capture_header_t header = {
+        .version = FALL_CAPTURE_VERSION,
+        .num_samples = count,
+        .pre_samples = count - FALL_CAPTURE_POST_SAMPLES - 1,
+        .sample_period_us = count > 1 ? (newest->timestamp_us - oldest->timestamp_us) / (count - 1) : 0,
+        .trigger_us = cap->trigger_us,
+        .first = { oldest->x, oldest->y, oldest->z },
+    };
+    memcpy(blob->data, &header, sizeof(header));
+    size_t len = sizeof(header);
+
+    const imu_sample_t *prev = oldest;
+    for (uint32_t i = 1; i < count; i++) {
+        const imu_sample_t *s = &cap->history[(first + i) & HISTORY_MASK];
+        len += put_delta(&blob->data[len], s->x - prev->x);
+        len += put_delta(&blob->data[len], s->y - prev->y);
+        len += put_delta(&blob->data[len], s->z - prev->z);
+        prev = s;
+    }
+    blob->len = len;
+
+    if (fall_capture_queue == NULL || xQueueSend(fall_capture_queue, &blob, 0) != pdPASS) {
+        cap->dropped++;
+        fall_capture_release(blob);
+        return;
+    }
+    ESP_LOGI(TAG, "Captured %lu samples into %u bytes (raw %u)",
+             (unsigned long)count, (unsigned)len, (unsigned)(count * 6));
+}
+
+void fall_capture_push(fall_capture_t *cap, const imu_sample_t *sample) {
+    cap->history[cap->head & HISTORY_MASK] = *sample;
+    cap->head++;
+
+    if (cap->armed && --cap->post_remaining == 0) {
+        cap->armed = false;
+        seal_capture(cap);
+    }
+}
+
+// Call right after pushing the trigger sample. Ignored while a capture is in progress.
+void fall_capture_trigger(fall_capture_t *cap, uint32_t trigger_us) {
+    if (cap->armed || cap->head < FALL_CAPTURE_PRE_SAMPLES) {
+        return;
+    }
+    cap->armed = true;
+    cap->post_remaining = FALL_CAPTURE_POST_SAMPLES;
+    cap->trigger_us = trigger_us;
+}
+
+// Hand a blob back once it has been uploaded (or given up on)
+void fall_capture_release(fall_capture_blob_t *blob) {
+    atomic_store(&blob->in_use, false);
+}
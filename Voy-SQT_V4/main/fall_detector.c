@@ -0,0 +1,143 @@
+#include <string.h>
+#include "fall_detector.h"
+
+// Convert a threshold in milli-g to squared raw ADC counts
+static int32_t mg_to_counts_sq(const fall_detector_config_t *config, int32_t mg) {
+    int32_t counts = mg * config->counts_per_g / 1000;
+    return counts * counts;
+}
+
+// Integer square root, only used once per reported event
+static uint32_t isqrt32(uint32_t n) {
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > n) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (n >= root + bit) {
+            n -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+void fall_detector_default_config(fall_detector_config_t *config) {
+    config->zero_g_counts[0] = FALL_DEFAULT_ZERO_G_COUNTS;
+    config->zero_g_counts[1] = FALL_DEFAULT_ZERO_G_COUNTS;
+    config->zero_g_counts[2] = FALL_DEFAULT_ZERO_G_COUNTS;
+    config->counts_per_g = FALL_DEFAULT_COUNTS_PER_G;
+
+    // A 10 cm drop is ~140 ms of free fall
+    config->freefall_threshold_mg = 400;
+    config->freefall_min_ms = 80;
+
+    // The ADXL327 saturates a little above 2 g, so any clipped spike qualifies
+    config->impact_threshold_mg = 1800;
+    config->impact_window_ms = 200;
+
+    config->stillness_tolerance_mg = 250;
+    config->stillness_ms = 500;
+    config->stillness_timeout_ms = 3000;
+}
+
+void fall_detector_init(fall_detector_t *fd, const fall_detector_config_t *config) {
+    memset(fd, 0, sizeof(*fd));
+    fd->config = *config;
+
+    fd->freefall_sq = mg_to_counts_sq(config, config->freefall_threshold_mg);
+    fd->impact_sq = mg_to_counts_sq(config, config->impact_threshold_mg);
+
+    int32_t still_low = 1000 - config->stillness_tolerance_mg;
+    fd->still_low_sq = still_low > 0 ? mg_to_counts_sq(config, still_low) : 0;
+    fd->still_high_sq = mg_to_counts_sq(config, 1000 + config->stillness_tolerance_mg);
+
+    fd->state = FALL_STATE_IDLE;
+}
+
+static void report_event(fall_detector_t *fd, bool settled, fall_event_t *event_out) {
+    if (event_out) {
+        uint32_t peak_counts = isqrt32((uint32_t)fd->peak_sq);
+        event_out->timestamp_us = fd->impact_us;
+        event_out->freefall_ms = (fd->freefall_end_us - fd->freefall_start_us) / 1000;
+        event_out->peak_mg = peak_counts * 1000 / fd->config.counts_per_g;
+        event_out->settled = settled;
+    }
+    fd->state = FALL_STATE_IDLE;
+}
+
+// Feed one sample. Returns true and fills event_out when a fall completes.
+bool fall_detector_update(fall_detector_t *fd, const imu_sample_t *sample, fall_event_t *event_out) {
+    const fall_detector_config_t *cfg = &fd->config;
+    uint32_t now = sample->timestamp_us;
+
+    int32_t dx = sample->x - cfg->zero_g_counts[0];
+    int32_t dy = sample->y - cfg->zero_g_counts[1];
+    int32_t dz = sample->z - cfg->zero_g_counts[2];
+    int32_t mag_sq = dx * dx + dy * dy + dz * dz;
+
+    switch (fd->state) {
+        case FALL_STATE_IDLE:
+            if (mag_sq < fd->freefall_sq) {
+                fd->state = FALL_STATE_FREEFALL;
+                fd->freefall_start_us = now;
+            }
+            break;
+
+        case FALL_STATE_FREEFALL:
+            if (mag_sq < fd->freefall_sq) {
+                break;
+            }
+            // Free fall ended, too short to be a drop?
+            if (now - fd->freefall_start_us < (uint32_t)cfg->freefall_min_ms * 1000) {
+                fd->state = FALL_STATE_IDLE;
+                break;
+            }
+            fd->freefall_end_us = now;
+            fd->peak_sq = 0;
+            fd->state = FALL_STATE_IMPACT_WAIT;
+            // fall through - this sample may already be the impact
+
+        case FALL_STATE_IMPACT_WAIT:
+            if (mag_sq > fd->peak_sq) {
+                fd->peak_sq = mag_sq;
+            }
+            if (mag_sq >= fd->impact_sq) {
+                fd->impact_us = now;
+                fd->still_active = false;
+                fd->state = FALL_STATE_STILLNESS;
+            } else if (now - fd->freefall_end_us > (uint32_t)cfg->impact_window_ms * 1000) {
+                // Free fall without an impact, e.g. tossed and caught
+                fd->state = FALL_STATE_IDLE;
+            }
+            break;
+
+        case FALL_STATE_STILLNESS:
+            if (mag_sq > fd->peak_sq) {
+                fd->peak_sq = mag_sq;
+            }
+            if (mag_sq >= fd->still_low_sq && mag_sq <= fd->still_high_sq) {
+                if (!fd->still_active) {
+                    fd->still_active = true;
+                    fd->still_start_us = now;
+                } else if (now - fd->still_start_us >= (uint32_t)cfg->stillness_ms * 1000) {
+                    report_event(fd, true, event_out);
+                    return true;
+                }
+            } else {
+                fd->still_active = false;
+            }
+            if (now - fd->impact_us > (uint32_t)cfg->stillness_timeout_ms * 1000) {
+                report_event(fd, false, event_out);
+                return true;
+            }
+            break;
+    }
+
+    return false;
+}
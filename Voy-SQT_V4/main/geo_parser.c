@@ -0,0 +1,171 @@
+#include <stdlib.h>
+#include <string.h>
+#include "geo_parser.h"
+
+// Sentinel lengths for keys/tokens that did not fit and must never match
+#define TOO_LONG 0xFF
+
+static bool path_is(const geo_parser_t *p, int level, const char *key) {
+    return strcmp(p->path[level], key) == 0;
+}
+
+// A number or literal ended, keep it if its path is one we want
+static void end_token(geo_parser_t *p) {
+    if (p->token_len == 0) {
+        return;
+    }
+    if (p->token_len == TOO_LONG) {
+        p->token_len = 0;
+        return;
+    }
+    p->token[p->token_len] = '\0';
+    p->token_len = 0;
+
+    if (p->depth == 2 && path_is(p, 0, "location")) {
+        if (path_is(p, 1, "lat")) {
+            p->lat = strtod(p->token, NULL);
+            p->found |= GEO_FOUND_LAT;
+        } else if (path_is(p, 1, "lng")) {
+            p->lng = strtod(p->token, NULL);
+            p->found |= GEO_FOUND_LNG;
+        }
+    } else if (p->depth == 1 && path_is(p, 0, "accuracy")) {
+        p->accuracy = strtod(p->token, NULL);
+        p->found |= GEO_FOUND_ACCURACY;
+    } else if (p->depth == 2 && path_is(p, 0, "error") && path_is(p, 1, "code")) {
+        p->error_code = atoi(p->token);
+        p->found |= GEO_FOUND_ERROR;
+    }
+}
+
+static void open_container(geo_parser_t *p, bool object) {
+    if (p->depth >= GEO_PARSER_MAX_DEPTH) {
+        p->failed = true;
+        return;
+    }
+    if (object) {
+        p->is_object |= 1U << p->depth;
+    } else {
+        p->is_object &= ~(1U << p->depth);
+    }
+    p->depth++;
+    // Forget the previous sibling's key at this level
+    if (p->depth <= GEO_PARSER_PATH_DEPTH) {
+        p->path[p->depth - 1][0] = '\0';
+    }
+    p->expect_key = object;
+}
+
+static void close_container(geo_parser_t *p) {
+    end_token(p);
+    if (p->depth == 0) {
+        p->failed = true;
+        return;
+    }
+    p->depth--;
+    p->expect_key = false;
+}
+
+static bool in_object(const geo_parser_t *p) {
+    return p->depth > 0 && (p->is_object & (1U << (p->depth - 1)));
+}
+
+static void string_char(geo_parser_t *p, char c) {
+    if (!p->string_is_key || p->key_len == TOO_LONG) {
+        return;
+    }
+    if (p->key_len + 1 >= GEO_PARSER_KEY_MAX) {
+        p->key_len = TOO_LONG;
+        return;
+    }
+    p->key[p->key_len++] = c;
+}
+
+static void end_string(geo_parser_t *p) {
+    p->in_string = false;
+    if (!p->string_is_key) {
+        return;
+    }
+    // Remember the key for its level, over-long keys become empty
+    if (p->depth >= 1 && p->depth <= GEO_PARSER_PATH_DEPTH) {
+        size_t n = p->key_len == TOO_LONG ? 0 : p->key_len;
+        memcpy(p->path[p->depth - 1], p->key, n);
+        p->path[p->depth - 1][n] = '\0';
+    }
+}
+
+void geo_parser_init(geo_parser_t *p) {
+    memset(p, 0, sizeof(*p));
+}
+
+// Feed the next chunk of the body, chunks may split anywhere
+void geo_parser_feed(geo_parser_t *p, const char *data, size_t len) {
+    for (size_t i = 0; i < len && !p->failed; i++) {
+        char c = data[i];
+
+        if (p->in_string) {
+            if (p->escape) {
+                p->escape = false;
+                string_char(p, c);
+            } else if (c == '\\') {
+                p->escape = true;
+            } else if (c == '"') {
+                end_string(p);
+            } else {
+                string_char(p, c);
+            }
+            continue;
+        }
+
+        switch (c) {
+            case '{':
+                open_container(p, true);
+                break;
+            case '[':
+                open_container(p, false);
+                break;
+            case '}':
+            case ']':
+                close_container(p);
+                break;
+            case '"':
+                p->in_string = true;
+                p->string_is_key = p->expect_key;
+                p->key_len = 0;
+                break;
+            case ':':
+                p->expect_key = false;
+                break;
+            case ',':
+                end_token(p);
+                p->expect_key = in_object(p);
+                break;
+            case ' ':
+            case '\t':
+            case '\r':
+            case '\n':
+                end_token(p);
+                break;
+            default:
+                // Number or true/false/null
+                if (p->token_len == TOO_LONG) {
+                    break;
+                }
+                if (p->token_len + 1 >= GEO_PARSER_TOKEN_MAX) {
+                    p->token_len = TOO_LONG;
+                    break;
+                }
+                p->token[p->token_len++] = c;
+                break;
+        }
+    }
+}
+
+// Call once the body is complete. True if both coordinates were found.
+bool geo_parser_finish(geo_parser_t *p) {
+    end_token(p);
+    if (p->depth != 0 || p->in_string) {
+        p->failed = true;
+    }
+    return !p->failed && (p->found & (GEO_FOUND_LAT | GEO_FOUND_LNG)) == (GEO_FOUND_LAT | GEO_FOUND_LNG);
+}
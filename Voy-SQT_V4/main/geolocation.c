@@ -5,19 +5,28 @@
 #include <stdio.h>
 #include "esp_log.h"
 #include "esp_http_client.h"
+#include "esp_timer.h"
 #include "geolocation.h"
+#include "json_writer.h"
+#include "geo_parser.h"
+#include "retry.h"
+#include "wifi_scan.h"
 #include "esp_crt_bundle.h"
 
 static const char *TAG = "GEO";
 
-QueueHandle_t wifi_json_queue = NULL;
+// Long-lived geolocation client. Keeps the TLS connection open between
+// fixes and holds the session ticket to resume it when the server closes it.
+static esp_http_client_handle_t geo_client = NULL;
 
-// Define a structure to hold the response buffer and current offset.
-typedef struct {
-    char *buffer;    // Pointer to response buffer.
-    int offset;      // Current offset in the buffer.
-    int buffer_len;  // Total length of the buffer.
-} response_data_t;
+// Shared by every geolocation request
+retry_policy_t geo_retry;
+static geo_parser_t geo_parser;
+static geo_client_stats_t geo_stats;
+
+// Set by the event handler when a request had to open a new connection
+static bool new_connection;
+static int64_t connected_at_us;
 
 // Helper function to pretty-print a JSON string.
 void pretty_print_json(const char *json_str) {
@@ -47,55 +56,20 @@ void pretty_print_json(const char *json_str) {
     cJSON_Delete(json);
 }
 
+// Scan and keep the MAX_APS strongest distinct APs (see wifi_scan.h)
 wifi_ap_t *create_wifi_aps_array(size_t *num_aps_out) {
-    wifi_scan_config_t scan_config = {
-        .ssid = 0,
-        .bssid = 0,
-        .channel = 0,
-        .show_hidden = true
-    };
-
-    esp_err_t err = esp_wifi_scan_start(&scan_config, true);
-    if (err != ESP_OK) {
-        printf("Error starting WiFi scan: %d\n", err);
-        return NULL;
-    }
-
-    uint16_t ap_num = 0;
-    err = esp_wifi_scan_get_ap_num(&ap_num);
-    if (err != ESP_OK) {
-        printf("Error getting AP number: %d\n", err);
-        return NULL;
-    }
-
-    // Apply the cap, limit to MAX_APS
-    if (ap_num > MAX_APS) {
-        ap_num = MAX_APS;
-    }
+    // Too big for the scan task stack, and only that task scans
+    static wifi_ap_record_t ap_records[MAX_APS];
+    size_t ap_num = wifi_scan_strongest(ap_records, MAX_APS);
 
     if (ap_num == 0) {
         *num_aps_out = 0;
         return NULL;
     }
 
-    // Allocate storage for the raw scan results
-    wifi_ap_record_t *ap_records = malloc(sizeof(wifi_ap_record_t) * ap_num);
-    if (ap_records == NULL) {
-        printf("Failed to allocate memory for AP records\n");
-        return NULL;
-    }
-
-    err = esp_wifi_scan_get_ap_records(&ap_num, ap_records);
-    if (err != ESP_OK) {
-        printf("Error getting AP records: %d\n", err);
-        free(ap_records);
-        return NULL;
-    }
-
     wifi_ap_t *wifi_aps = malloc(sizeof(wifi_ap_t) * ap_num);
     if (wifi_aps == NULL) {
         printf("Failed to allocate memory for wifi_aps array\n");
-        free(ap_records);
         return NULL;
     }
 
@@ -110,94 +84,56 @@ wifi_ap_t *create_wifi_aps_array(size_t *num_aps_out) {
     }
 
     *num_aps_out = ap_num;
-    free(ap_records);
-
     return wifi_aps;
 }
 
-char *generate_wifi_scan_json(const wifi_ap_t *wifi_aps, size_t num_aps) {
-    // Create the root JSON object.
-    cJSON *root = cJSON_CreateObject();
-    if (!root) {
-        return NULL;
-    }
-
-    // Add the "considerIp" key with the string value "false".
-    if (!cJSON_AddStringToObject(root, "considerIp", "false")) {
-        cJSON_Delete(root);
-        return NULL;
-    }
-
-    // Create the "wifiAccessPoints" array.
-    cJSON *ap_array = cJSON_CreateArray();
-    if (!ap_array) {
-        cJSON_Delete(root);
-        return NULL;
-    }
-    // Attach the array to the root object.
-    cJSON_AddItemToObject(root, "wifiAccessPoints", ap_array);
-
-    // Iterate through the provided WiFi access points.
+// Write the geolocation request body straight into buf, no heap involved.
+// Returns the length, or 0 if it does not fit.
+size_t generate_wifi_scan_json(const wifi_ap_t *wifi_aps, size_t num_aps, char *buf, size_t buf_len) {
+    json_writer_t w;
+    json_writer_init(&w, buf, buf_len);
+
+    json_begin_object(&w);
+    json_key(&w, "considerIp");
+    json_string(&w, "false");
+    json_key(&w, "wifiAccessPoints");
+    json_begin_array(&w);
     for (size_t i = 0; i < num_aps; i++) {
-        // Create a JSON object for each access point.
-        cJSON *ap_obj = cJSON_CreateObject();
-        if (!ap_obj) {
-            cJSON_Delete(root);
-            return NULL;
-        }
-
-        // Add the MAC address.
-        if (!cJSON_AddStringToObject(ap_obj, "macAddress", wifi_aps[i].mac)) {
-            cJSON_Delete(root);
-            return NULL;
-        }
-        // Add the signal strength.
-        if (!cJSON_AddNumberToObject(ap_obj, "signalStrength", wifi_aps[i].signal_strength)) {
-            cJSON_Delete(root);
-            return NULL;
-        }
-        // Add the signal-to-noise ratio.
-        if (!cJSON_AddNumberToObject(ap_obj, "signalToNoiseRatio", wifi_aps[i].signal_to_noise_ratio)) {
-            cJSON_Delete(root);
-            return NULL;
-        }
-        // Append the access point object to the array.
-        cJSON_AddItemToArray(ap_array, ap_obj);
-    }
-
-    // Convert the entire JSON object to a string.
-    // cJSON_PrintUnformatted allocates memory for the string.
-    char *json_str = cJSON_PrintUnformatted(root);
-
-    // Free the JSON object now that we have the string.
-    cJSON_Delete(root);
-
-    // Return the JSON string. The caller is responsible for calling free(json_str).
-    return json_str;
+        json_begin_object(&w);
+        json_key(&w, "macAddress");
+        json_string(&w, wifi_aps[i].mac);
+        json_key(&w, "signalStrength");
+        json_int(&w, wifi_aps[i].signal_strength);
+        json_key(&w, "signalToNoiseRatio");
+        json_int(&w, wifi_aps[i].signal_to_noise_ratio);
+        json_end_object(&w);
+    }
+    json_end_array(&w);
+    json_end_object(&w);
+
+    return json_writer_finish(&w);
 }
 
-// Updated event handler that uses our custom response_data_t for accumulating data.
+// Event handler that feeds the response body to a geo_parser_t as it arrives.
 esp_err_t _geolocation_event_handler(esp_http_client_event_t *evt) {
-    response_data_t *res_data = (response_data_t *)evt->user_data;
+    geo_parser_t *parser = (geo_parser_t *)evt->user_data;
     switch (evt->event_id) {
         case HTTP_EVENT_ERROR:
             ESP_LOGI(TAG, "HTTP_EVENT_ERROR");
             break;
         case HTTP_EVENT_ON_CONNECTED:
+            // Fired once TCP connect and the TLS handshake are done
             ESP_LOGI(TAG, "HTTP_EVENT_ON_CONNECTED");
+            new_connection = true;
+            connected_at_us = esp_timer_get_time();
             break;
         case HTTP_EVENT_HEADER_SENT:
             ESP_LOGI(TAG, "HTTP_EVENT_HEADER_SENT");
             break;
         case HTTP_EVENT_ON_DATA:
             ESP_LOGI(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
-            if (res_data && res_data->buffer && (res_data->offset + evt->data_len < res_data->buffer_len)) {
-                memcpy(res_data->buffer + res_data->offset, evt->data, evt->data_len);
-                res_data->offset += evt->data_len;
-                // Ensure buffer is null-terminated.
-                res_data->buffer[res_data->offset] = '\0';
-            } else {
-                ESP_LOGE(TAG, "Response buffer overflow or not initialized");
+            if (parser) {
+                geo_parser_feed(parser, evt->data, evt->data_len);
             }
             break;
         case HTTP_EVENT_ON_FINISH:
@@ -209,87 +145,97 @@ esp_err_t _geolocation_event_handler(esp_http_client_event_t *evt) {
     return ESP_OK;
 }
 
-// Function to process the JSON by sending it to the Google Geolocation API,
-// then printing the full response and extracting latitude and longitude.
-long_lat_t process_geolocation_json(char *json_str) {
-    ESP_LOGI(TAG, "Sending WiFi data to Google API");
-
-    long_lat_t loc = {0};
-
-    // Allocate a response buffer.
-    char response_buffer[512] = {0};
-
-    // Create our response data structure.
-    response_data_t res_data = {
-        .buffer = response_buffer,
-        .offset = 0,
-        .buffer_len = sizeof(response_buffer)
-    };
+// Send the scan JSON to the Google Geolocation API and pull latitude,
+// longitude and accuracy out of the response as it streams in.
+bool process_geolocation_json(const char *json_str, size_t json_len, long_lat_t *loc_out) {
+    // Backing off or API unreachable, do not wake the radio for it
+    if (!retry_begin(&geo_retry)) {
+        ESP_LOGW(TAG, "Geolocation %s, skipping request", retry_state_name(retry_get_state(&geo_retry)));
+        return false;
+    }
 
-    esp_http_client_config_t config = {
-        .url = GEOLOCATION_URL,
-        .method = HTTP_METHOD_POST,
-        .timeout_ms = 5000,
-        .buffer_size = sizeof(response_buffer),
-        .user_data = &res_data,               
-        .crt_bundle_attach = esp_crt_bundle_attach,
-        .event_handler = _geolocation_event_handler,
-    };
+    ESP_LOGI(TAG, "Sending WiFi data to Google API");
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (client == NULL) {
-        ESP_LOGE(TAG, "Failed to initialize HTTP client");
-        free(json_str);
-        return loc;
+    if (geo_client == NULL) {
+        esp_http_client_config_t config = {
+            .url = GEOLOCATION_URL,
+            .method = HTTP_METHOD_POST,
+            .timeout_ms = 5000,
+            .keep_alive_enable = true,
+            .save_client_session = true,
+            .user_data = &geo_parser,
+            .crt_bundle_attach = esp_crt_bundle_attach,
+            .event_handler = _geolocation_event_handler,
+        };
+        geo_client = esp_http_client_init(&config);
+        if (geo_client == NULL) {
+            ESP_LOGE(TAG, "Failed to initialize HTTP client");
+            retry_end(&geo_retry, false);
+            return false;
+        }
+        // Set the Content-Type header once, it is kept across requests
+        esp_http_client_set_header(geo_client, "Content-Type", "application/json");
     }
 
-    // Set the Content-Type header and assign the JSON payload.
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, json_str, strlen(json_str));
+    geo_parser_init(&geo_parser);
+    esp_http_client_set_post_field(geo_client, json_str, json_len);
 
     // Perform the HTTP request.
-    esp_err_t err = esp_http_client_perform(client);
+    new_connection = false;
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t err = esp_http_client_perform(geo_client);
+    int64_t end_us = esp_timer_get_time();
+
+    // Split the time between connecting (TCP + TLS handshake) and the request itself
+    geo_stats.requests++;
+    if (new_connection) {
+        geo_stats.handshakes++;
+        geo_stats.handshake_time_us += connected_at_us - start_us;
+        geo_stats.request_time_us += end_us - connected_at_us;
+        ESP_LOGI(TAG, "Connected in %lld ms, request %lld ms",
+                 (connected_at_us - start_us) / 1000, (end_us - connected_at_us) / 1000);
+    } else {
+        geo_stats.request_time_us += end_us - start_us;
+        ESP_LOGI(TAG, "Reused connection, request %lld ms", (end_us - start_us) / 1000);
+    }
+
+    bool found = false;
+    bool reachable = err == ESP_OK;
     if (err == ESP_OK) {
-        int status_code = esp_http_client_get_status_code(client);
+        int status_code = esp_http_client_get_status_code(geo_client);
         ESP_LOGI(TAG, "HTTP POST Status = %d", status_code);
-
-        // Use the accumulated response from our response_data_t structure.
-        if (res_data.offset > 0) {
-
-            // Parse the JSON response to extract latitude and longitude.
-            cJSON *root = cJSON_Parse(res_data.buffer);
-            if (root) {
-                cJSON *location = cJSON_GetObjectItem(root, "location");
-                if (location) {
-                    cJSON *lat = cJSON_GetObjectItem(location, "lat");
-                    cJSON *lng = cJSON_GetObjectItem(location, "lng");
-                    if (lat && lng) {
-                        ESP_LOGI(TAG, "Latitude: %f, Longitude: %f", lat->valuedouble, lng->valuedouble);
-                        loc.longitude = lng->valuedouble;
-                        loc.latitude = lat->valuedouble;
-                    }
-                    else {
-                        ESP_LOGE(TAG, "Failed to retrieve coordinates from JSON response.");
-                    }
-                } 
-                else {
-                    ESP_LOGE(TAG, "No location field found in JSON response.");
-                }
-                cJSON_Delete(root);
-            } 
-            else {
-                ESP_LOGE(TAG, "Failed to parse JSON response.");
-            }
-        } 
+        // 403 is an exhausted quota, retrying right away only burns the radio
+        reachable = !retry_http_status_failed(status_code) && status_code != 403;
+
+        if (geo_parser_finish(&geo_parser)) {
+            ESP_LOGI(TAG, "Latitude: %f, Longitude: %f, Accuracy: %.0f m", geo_parser.lat, geo_parser.lng, geo_parser.accuracy);
+            loc_out->longitude = geo_parser.lng;
+            loc_out->latitude = geo_parser.lat;
+            loc_out->accuracy = geo_parser.found & GEO_FOUND_ACCURACY ? geo_parser.accuracy : 0.0;
+            found = true;
+        }
+        else if (geo_parser.found & GEO_FOUND_ERROR) {
+            ESP_LOGE(TAG, "Geolocation API error %d", geo_parser.error_code);
+        }
+        else if (geo_parser.failed) {
+            ESP_LOGE(TAG, "Failed to parse JSON response.");
+        }
         else {
-            ESP_LOGE(TAG, "No response data received in the buffer.");
+            ESP_LOGE(TAG, "Failed to retrieve coordinates from JSON response.");
         }
     } 
     else {
+        // Close the socket but keep the handle, and with it the TLS session
+        // ticket, so the next request resumes instead of a full handshake
         ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
+        geo_stats.errors++;
+        esp_http_client_close(geo_client);
     }
 
-    esp_http_client_cleanup(client);
-    free(json_str);
-    return loc;
-}
\ No newline at end of file
+    retry_end(&geo_retry, reachable);
+    return found;
+}
+
+void geolocation_get_client_stats(geo_client_stats_t *stats_out) {
+    *stats_out = geo_stats;
+}
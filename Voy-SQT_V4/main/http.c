@@ -3,12 +3,25 @@
 #include "esp_log.h"
 #include "esp_system.h"
 #include "esp_err.h"
+#include "esp_timer.h"
 #include "esp_http_client.h"
 #include "nvs_flash.h"
 #include "http.h"
+#include "retry.h"
 
 static const char *TAG = "HTTP";
 
+// Long-lived backend client. Only used from one task at a time.
+static esp_http_client_handle_t backend_client = NULL;
+static http_uploader_stats_t uploader_stats;
+
+// Shared by every upload to the backend
+retry_policy_t backend_retry;
+
+// Set by the event handler when a request had to open a new connection
+static bool new_connection;
+static int64_t connected_at_us;
+
 esp_err_t _backend_http_event_handler(esp_http_client_event_t *evt)
 {
     switch (evt->event_id) {
@@ -17,49 +30,114 @@ esp_err_t _backend_http_event_handler(esp_http_client_event_t *evt)
             break;
         case HTTP_EVENT_ON_CONNECTED:
             ESP_LOGI(TAG, "HTTP_EVENT_ON_CONNECTED");
+            new_connection = true;
+            connected_at_us = esp_timer_get_time();
             break;
         case HTTP_EVENT_HEADER_SENT:
-            ESP_LOGI(TAG, "HTTP_EVENT_HEADER_SENT");
+            ESP_LOGD(TAG, "HTTP_EVENT_HEADER_SENT");
             break;
         case HTTP_EVENT_ON_DATA:
             if (!evt->data_len) {
-                ESP_LOGI(TAG, "HTTP_EVENT_ON_DATA, no data in response");
+                ESP_LOGD(TAG, "HTTP_EVENT_ON_DATA, no data in response");
             } else {
-                ESP_LOGI(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
+                ESP_LOGD(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
             }
             break;
+        case HTTP_EVENT_DISCONNECTED:
+            ESP_LOGI(TAG, "HTTP_EVENT_DISCONNECTED");
+            break;
         default:
             break;
     }
     return ESP_OK;
 }
 
-void send_post_request(int fall_events, int overtemp_events, int overhum_events, double longitude, double latitude) {
-    esp_http_client_config_t config = {
-        .url = SERVER_URL,
-        .method = HTTP_METHOD_POST,
-        .event_handler = _backend_http_event_handler,
-    };
+// POST over the persistent connection, opening it only when needed.
+// Only a 2xx answer is ESP_OK. 429 and 5xx return ESP_FAIL, callers keep
+// the data and the retry policy backs off. Any other status returns
+// ESP_ERR_INVALID_RESPONSE: the backend is up but will never accept this
+// payload, so callers drop it, and the link counts as working for the
+// retry policy so one bad payload cannot open the breaker.
+static esp_err_t uploader_post(const char *url, const char *content_type, const char *data, size_t len) {
+    // Backing off or backend down, do not wake the radio for it
+    if (!retry_begin(&backend_retry)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (backend_client == NULL) {
+        esp_http_client_config_t config = {
+            .url = url,
+            .method = HTTP_METHOD_POST,
+            .timeout_ms = 5000,
+            .keep_alive_enable = true,
+            .event_handler = _backend_http_event_handler,
+        };
+        backend_client = esp_http_client_init(&config);
+        if (backend_client == NULL) {
+            ESP_LOGE(TAG, "Failed to initialize HTTP client");
+            retry_end(&backend_retry, false);
+            return ESP_FAIL;
+        }
+    } else {
+        esp_http_client_set_url(backend_client, url);
+        esp_http_client_set_method(backend_client, HTTP_METHOD_POST);
+    }
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
+    esp_http_client_set_header(backend_client, "Content-Type", content_type);
+    esp_http_client_set_post_field(backend_client, data, len);
 
-    // Prepare POST data
-    char post_data[128];
-    snprintf(post_data, sizeof(post_data), "{\"uid\":%d, \"long\":%f, \"lat\":%f, \"fall\":%d, \"temp\":%d, \"hum\":%d}", 2808, longitude, latitude, fall_events, overtemp_events, overhum_events);
-    
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, post_data, strlen(post_data));
+    new_connection = false;
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t err = esp_http_client_perform(backend_client);
+    int64_t end_us = esp_timer_get_time();
 
-    // Perform the POST request
-    esp_err_t err = esp_http_client_perform(client);
+    // Split the time between opening the socket and the request itself
+    uploader_stats.requests++;
+    if (new_connection) {
+        uploader_stats.connects++;
+        uploader_stats.connect_time_us += connected_at_us - start_us;
+        uploader_stats.request_time_us += end_us - connected_at_us;
+    } else {
+        uploader_stats.request_time_us += end_us - start_us;
+    }
 
     if (err == ESP_OK) {
-        ESP_LOGI(TAG, "POST request successful, status code: %d", esp_http_client_get_status_code(client));
+        int status_code = esp_http_client_get_status_code(backend_client);
+        if (retry_http_status_failed(status_code)) {
+            // Server overloaded or down, keep the data and back off
+            ESP_LOGW(TAG, "POST request refused, status code: %d", status_code);
+            uploader_stats.errors++;
+            err = ESP_FAIL;
+        } else if (status_code < 200 || status_code >= 300) {
+            // Not accepted, e.g. 400/404/413/415/422: not delivered
+            ESP_LOGW(TAG, "POST request rejected, status code: %d", status_code);
+            uploader_stats.rejected++;
+            err = ESP_ERR_INVALID_RESPONSE;
+        } else {
+            ESP_LOGI(TAG, "POST request successful, status code: %d", status_code);
+        }
     } else {
+        // Drop the connection, the next request reconnects from scratch
         ESP_LOGE(TAG, "POST request failed, error: %s", esp_err_to_name(err));
+        uploader_stats.errors++;
+        esp_http_client_cleanup(backend_client);
+        backend_client = NULL;
     }
-    ESP_LOGI(TAG, "Sending POST request to %s with data: %s", SERVER_URL, post_data);
+    retry_end(&backend_retry, err == ESP_OK || err == ESP_ERR_INVALID_RESPONSE);
+    return err;
+}
+
+// Upload a batch of telemetry snapshots (see batch.h) in BATCH_FORMAT
+esp_err_t send_batch_request(const void *data, size_t len, const char *content_type) {
+    ESP_LOGI(TAG, "Sending %u byte %s batch to %s", (unsigned)len, content_type, BATCH_UPLOAD_URL);
+    return uploader_post(BATCH_UPLOAD_URL, content_type, data, len);
+}
+
+// Upload one delta-encoded fall waveform (see fall_capture.h for the layout)
+esp_err_t send_waveform_request(const uint8_t *blob, size_t len) {
+    return uploader_post(WAVEFORM_URL, "application/octet-stream", (const char *)blob, len);
+}
 
-    // Cleanup
-    esp_http_client_cleanup(client);
-}
\ No newline at end of file
+void http_get_uploader_stats(http_uploader_stats_t *stats_out) {
+    *stats_out = uploader_stats;
+}
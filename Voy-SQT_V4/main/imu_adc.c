@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_adc/adc_continuous.h"
+#include "soc/soc_caps.h"
+
+#include "io_pins.h"
+#include "imu_adc.h"
+
+static const char *TAG = "imu_adc";
+
+#define IMU_ADC_NUM_AXES        3
+#define IMU_ADC_DMA_FRAME_BYTES 1024    // One DMA frame, multiple of SOC_ADC_DIGI_DATA_BYTES_PER_CONV
+#define IMU_ADC_DMA_POOL_BYTES  (4 * IMU_ADC_DMA_FRAME_BYTES)
+#define IMU_ADC_TASK_STACK      3072
+#define IMU_ADC_TASK_PRIORITY   10
+
+static const adc_channel_t imu_channels[IMU_ADC_NUM_AXES] = {
+    IMU_X_PIN, IMU_Y_PIN, IMU_Z_PIN
+};
+
+static adc_continuous_handle_t adc_handle = NULL;
+static TaskHandle_t acq_task_handle = NULL;
+static volatile bool running = false;
+
+static imu_adc_config_t active_config;
+static imu_adc_stats_t stats;
+
+// Bumped from the driver ISR, merged into stats by imu_adc_get_stats()
+static _Atomic uint32_t dma_overflows;
+
+// Conversions handed to the driver pool so far and when the last DMA frame
+// completed, so samples are timed from the DMA completion rather than from
+// whenever the acquisition task gets to them
+static portMUX_TYPE dma_time_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t dma_conversions;
+static int64_t dma_done_us;
+
+static portMUX_TYPE latest_mux = portMUX_INITIALIZER_UNLOCKED;
+static imu_data_t latest_sample;
+
+// Kept static so the frame doesn't live on the acquisition task stack
+static imu_frame_t frame;
+static uint8_t dma_buf[IMU_ADC_DMA_FRAME_BYTES];
+
+// DMA frame complete, wake the acquisition task
+static bool IRAM_ATTR on_conv_done(adc_continuous_handle_t handle,
+                                   const adc_continuous_evt_data_t *edata, void *user_data) {
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&dma_time_mux);
+    dma_conversions += edata->size / SOC_ADC_DIGI_RESULT_BYTES;
+    dma_done_us = now;
+    portEXIT_CRITICAL_ISR(&dma_time_mux);
+
+    BaseType_t must_yield = pdFALSE;
+    vTaskNotifyGiveFromISR(acq_task_handle, &must_yield);
+    return must_yield == pdTRUE;
+}
+
+// Driver ran out of pool space, the acquisition task fell behind. The frame
+// just counted in on_conv_done() was dropped and never reaches the task.
+static bool IRAM_ATTR on_pool_ovf(adc_continuous_handle_t handle,
+                                  const adc_continuous_evt_data_t *edata, void *user_data) {
+    portENTER_CRITICAL_ISR(&dma_time_mux);
+    dma_conversions -= IMU_ADC_DMA_FRAME_BYTES / SOC_ADC_DIGI_RESULT_BYTES;
+    portEXIT_CRITICAL_ISR(&dma_time_mux);
+    atomic_fetch_add_explicit(&dma_overflows, 1, memory_order_relaxed);
+    return false;
+}
+
+static int axis_for_channel(uint32_t channel) {
+    for (int i = 0; i < IMU_ADC_NUM_AXES; i++) {
+        if (imu_channels[i] == channel) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// last_conversion is the stream position of the conversion that completed
+// the newest sample in the frame
+static void emit_frame(uint32_t last_conversion) {
+    portENTER_CRITICAL(&dma_time_mux);
+    uint32_t conversions = dma_conversions;
+    int64_t done_us = dma_done_us;
+    portEXIT_CRITICAL(&dma_time_mux);
+
+    // Count back from the end of the last completed DMA frame
+    int64_t last_us = done_us - (int64_t)(conversions - last_conversion) * 1000000 / stats.conv_rate_hz;
+    frame.sample_period_us = 1000000 / stats.sample_rate_hz;
+    frame.timestamp_us = last_us - (int64_t)(frame.num_samples - 1) * frame.sample_period_us;
+    frame.sequence = stats.frames++;
+
+    if (active_config.on_frame) {
+        active_config.on_frame(&frame, active_config.on_frame_arg);
+    }
+    frame.num_samples = 0;
+}
+
+static void imu_adc_task(void *pvParameter) {
+    // Running sums used to box-filter raw conversions down to the output rate
+    uint32_t sum[IMU_ADC_NUM_AXES] = {0};
+    uint32_t count[IMU_ADC_NUM_AXES] = {0};
+    // Conversions read from the driver pool, the same stream on_conv_done() counts
+    uint32_t consumed = 0;
+
+    frame.num_samples = 0;
+
+    while (running) {
+        // Block until the driver signals a finished DMA frame
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        uint32_t len = 0;
+        while (running && adc_continuous_read(adc_handle, dma_buf, sizeof(dma_buf), &len, 0) == ESP_OK) {
+            for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= len; i += SOC_ADC_DIGI_RESULT_BYTES) {
+                consumed++;
+                adc_digi_output_data_t *p = (adc_digi_output_data_t *)&dma_buf[i];
+                int axis = axis_for_channel(p->type1.channel);
+                if (axis < 0) {
+                    continue;
+                }
+                sum[axis] += p->type1.data;
+                count[axis]++;
+
+                if (count[0] < stats.oversample || count[1] < stats.oversample || count[2] < stats.oversample) {
+                    continue;
+                }
+
+                // One full output sample is ready
+                imu_data_t sample = {
+                    .x = sum[0] / count[0],
+                    .y = sum[1] / count[1],
+                    .z = sum[2] / count[2],
+                };
+                memset(sum, 0, sizeof(sum));
+                memset(count, 0, sizeof(count));
+
+                frame.samples[frame.num_samples++] = sample;
+                portENTER_CRITICAL(&latest_mux);
+                latest_sample = sample;
+                portEXIT_CRITICAL(&latest_mux);
+
+                if (frame.num_samples == IMU_ADC_FRAME_SAMPLES) {
+                    emit_frame(consumed);
+                }
+            }
+        }
+    }
+
+    acq_task_handle = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t imu_adc_start(const imu_adc_config_t *config) {
+    if (config == NULL || config->sample_rate_hz < IMU_ADC_MIN_RATE_HZ ||
+        config->sample_rate_hz > IMU_ADC_MAX_RATE_HZ) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (adc_handle != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    active_config = *config;
+    memset(&stats, 0, sizeof(stats));
+    atomic_store(&dma_overflows, 0);
+    dma_conversions = 0;
+    dma_done_us = 0;
+
+    // The DMA ADC has a minimum conversion rate well above what we need, so
+    // run at least that fast and average groups of conversions together.
+    uint32_t min_conv_rate = config->sample_rate_hz * IMU_ADC_NUM_AXES;
+    stats.oversample = (SOC_ADC_SAMPLE_FREQ_THRES_LOW + min_conv_rate - 1) / min_conv_rate;
+    if (stats.oversample == 0) {
+        stats.oversample = 1;
+    }
+    stats.conv_rate_hz = min_conv_rate * stats.oversample;
+    stats.sample_rate_hz = config->sample_rate_hz;
+
+    adc_continuous_handle_cfg_t handle_config = {
+        .max_store_buf_size = IMU_ADC_DMA_POOL_BYTES,
+        .conv_frame_size = IMU_ADC_DMA_FRAME_BYTES,
+    };
+    esp_err_t err = adc_continuous_new_handle(&handle_config, &adc_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create ADC handle: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    adc_digi_pattern_config_t pattern[IMU_ADC_NUM_AXES] = {0};
+    for (int i = 0; i < IMU_ADC_NUM_AXES; i++) {
+        pattern[i].atten = ADC_ATTEN_DB_12;
+        pattern[i].channel = imu_channels[i];
+        pattern[i].unit = ADC_UNIT_1;
+        pattern[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+
+    adc_continuous_config_t dig_config = {
+        .pattern_num = IMU_ADC_NUM_AXES,
+        .adc_pattern = pattern,
+        .sample_freq_hz = stats.conv_rate_hz,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+    };
+    err = adc_continuous_config(adc_handle, &dig_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure ADC: %s", esp_err_to_name(err));
+        goto fail;
+    }
+
+    adc_continuous_evt_cbs_t cbs = {
+        .on_conv_done = on_conv_done,
+        .on_pool_ovf = on_pool_ovf,
+    };
+    err = adc_continuous_register_event_callbacks(adc_handle, &cbs, NULL);
+    if (err != ESP_OK) {
+        goto fail;
+    }
+
+    running = true;
+    if (xTaskCreate(imu_adc_task, "IMU_ADC_Task", IMU_ADC_TASK_STACK, NULL,
+                    IMU_ADC_TASK_PRIORITY, &acq_task_handle) != pdPASS) {
+        running = false;
+        err = ESP_ERR_NO_MEM;
+        goto fail;
+    }
+
+    err = adc_continuous_start(adc_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start ADC: %s", esp_err_to_name(err));
+        running = false;
+        xTaskNotifyGive(acq_task_handle);
+        goto fail;
+    }
+
+    ESP_LOGI(TAG, "Sampling %d axes at %" PRIu32 " Hz (conversion rate %" PRIu32 " Hz, %" PRIu32 "x oversampling)",
+             IMU_ADC_NUM_AXES, stats.sample_rate_hz, stats.conv_rate_hz, stats.oversample);
+    return ESP_OK;
+
+fail:
+    while (acq_task_handle != NULL) {
+        vTaskDelay(1);
+    }
+    adc_continuous_deinit(adc_handle);
+    adc_handle = NULL;
+    return err;
+}
+
+esp_err_t imu_adc_stop(void) {
+    if (adc_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    running = false;
+    adc_continuous_stop(adc_handle);
+
+    // Wake the acquisition task so it can observe the stop and exit
+    if (acq_task_handle != NULL) {
+        xTaskNotifyGive(acq_task_handle);
+    }
+    while (acq_task_handle != NULL) {
+        vTaskDelay(1);
+    }
+
+    adc_continuous_deinit(adc_handle);
+    adc_handle = NULL;
+    return ESP_OK;
+}
+
+imu_data_t imu_adc_get_latest(void) {
+    portENTER_CRITICAL(&latest_mux);
+    imu_data_t sample = latest_sample;
+    portEXIT_CRITICAL(&latest_mux);
+    return sample;
+}
+
+void imu_adc_get_stats(imu_adc_stats_t *stats_out) {
+    if (stats_out) {
+        *stats_out = stats;
+        stats_out->dma_overflows = atomic_load_explicit(&dma_overflows, memory_order_relaxed);
+    }
+}
@@ -0,0 +1,90 @@
+#include <string.h>
+#include "imu_ring.h"
+
+static imu_sample_t imu_ring_storage[IMU_RING_CAPACITY];
+
+imu_ring_t imu_ring = {
+    .buffer = imu_ring_storage,
+    .mask = IMU_RING_CAPACITY - 1,
+    .head = 0,
+};
+
+// Capacity must be a power of two so indices can wrap with a mask
+void imu_ring_init(imu_ring_t *ring, imu_sample_t *storage, size_t capacity) {
+    ring->buffer = storage;
+    ring->mask = capacity - 1;
+    atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+}
+
+// Single producer only. Safe to call from an ISR: no locks, no blocking.
+void imu_ring_push(imu_ring_t *ring, const imu_sample_t *sample) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    // Seqlock writer order: the previous head must be visible before this
+    // slot starts changing, otherwise a reader could copy the half-written
+    // slot and still see a head that says it was safe
+    atomic_thread_fence(memory_order_release);
+    ring->buffer[head & ring->mask] = *sample;
+
+    // Publish the sample after its contents are written
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// Start reading from the newest sample onwards
+void imu_ring_reader_init(imu_ring_t *ring, imu_ring_reader_t *reader) {
+    reader->tail = atomic_load_explicit(&ring->head, memory_order_acquire);
+    reader->dropped = 0;
+}
+
+size_t imu_ring_available(imu_ring_t *ring, const imu_ring_reader_t *reader) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t pending = head - reader->tail;
+    uint32_t capacity = ring->mask + 1;
+    return pending > capacity ? capacity : pending;
+}
+
+size_t imu_ring_read(imu_ring_t *ring, imu_ring_reader_t *reader, imu_sample_t *out, size_t max_samples) {
+    uint32_t capacity = ring->mask + 1;
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    // Skip anything the producer has already lapped
+    if (head - reader->tail > capacity) {
+        reader->dropped += head - reader->tail - capacity;
+        reader->tail = head - capacity;
+    }
+
+    uint32_t count = head - reader->tail;
+    if (count > max_samples) {
+        count = max_samples;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    // Copy in at most two contiguous chunks
+    uint32_t start = reader->tail & ring->mask;
+    uint32_t first = capacity - start;
+    if (first > count) {
+        first = count;
+    }
+    memcpy(out, &ring->buffer[start], first * sizeof(imu_sample_t));
+    memcpy(out + first, &ring->buffer[0], (count - first) * sizeof(imu_sample_t));
+
+    // The producer may have overwritten the oldest copied slots while we were
+    // copying, and may be mid-write on slot (new head). Anything at or below
+    // (new head - capacity) is suspect; drop it.
+    atomic_thread_fence(memory_order_acquire);
+    uint32_t new_head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t overwritten = 0;
+    if (new_head - reader->tail >= capacity) {
+        overwritten = new_head - reader->tail - capacity + 1;
+        if (overwritten > count) {
+            overwritten = count;
+        }
+        memmove(out, out + overwritten, (count - overwritten) * sizeof(imu_sample_t));
+        reader->dropped += overwritten;
+    }
+
+    reader->tail += count;
+    return count - overwritten;
+}
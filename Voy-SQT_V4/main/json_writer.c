@@ -0,0 +1,148 @@
+#include <string.h>
+#include "json_writer.h"
+
+static void put(json_writer_t *w, const char *data, size_t n) {
+    // Keep one byte for the NUL written by json_writer_finish
+    if (w->overflow || w->cap - 1 - w->len < n) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, data, n);
+    w->len += n;
+}
+
+static void put_char(json_writer_t *w, char c) {
+    put(w, &c, 1);
+}
+
+// Emit the separator owed before a new key or array element
+static void begin_value(json_writer_t *w) {
+    if (w->after_key) {
+        w->after_key = false;
+        return;
+    }
+    uint32_t bit = 1UL << w->depth;
+    if (w->has_items & bit) {
+        put_char(w, ',');
+    }
+    w->has_items |= bit;
+}
+
+static void open_container(json_writer_t *w, char c) {
+    begin_value(w);
+    put_char(w, c);
+    if (w->depth + 1 >= JSON_WRITER_MAX_DEPTH) {
+        w->overflow = true;
+        return;
+    }
+    w->depth++;
+    w->has_items &= ~(1UL << w->depth);
+}
+
+static void close_container(json_writer_t *w, char c) {
+    if (w->depth > 0) {
+        w->depth--;
+    }
+    put_char(w, c);
+}
+
+static void put_escaped(json_writer_t *w, const char *s) {
+    static const char hex[] = "0123456789abcdef";
+
+    put_char(w, '"');
+    const char *run = s;
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        // Copy the plain run in one go, then the escape
+        put(w, run, s - run);
+        run = s + 1;
+        if (c == '"' || c == '\\') {
+            char esc[2] = { '\\', (char)c };
+            put(w, esc, 2);
+        } else {
+            char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+            put(w, esc, 6);
+        }
+    }
+    put(w, run, s - run);
+    put_char(w, '"');
+}
+
+void json_writer_init(json_writer_t *w, char *buf, size_t cap) {
+    w->buf = buf;
+    w->cap = cap;
+    w->len = 0;
+    w->overflow = cap == 0;
+    w->depth = 0;
+    w->after_key = false;
+    w->has_items = 0;
+}
+
+void json_begin_object(json_writer_t *w) {
+    open_container(w, '{');
+}
+
+void json_end_object(json_writer_t *w) {
+    close_container(w, '}');
+}
+
+void json_begin_array(json_writer_t *w) {
+    open_container(w, '[');
+}
+
+void json_end_array(json_writer_t *w) {
+    close_container(w, ']');
+}
+
+void json_key(json_writer_t *w, const char *key) {
+    begin_value(w);
+    put_escaped(w, key);
+    put_char(w, ':');
+    w->after_key = true;
+}
+
+void json_string(json_writer_t *w, const char *value) {
+    begin_value(w);
+    put_escaped(w, value);
+}
+
+void json_int(json_writer_t *w, int32_t value) {
+    char digits[11];
+    size_t n = 0;
+    // Work in unsigned so INT32_MIN does not overflow
+    uint32_t v = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+
+    begin_value(w);
+    if (value < 0) {
+        put_char(w, '-');
+    }
+    do {
+        digits[sizeof(digits) - 1 - n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    put(w, &digits[sizeof(digits) - n], n);
+}
+
+void json_bool(json_writer_t *w, bool value) {
+    begin_value(w);
+    if (value) {
+        put(w, "true", 4);
+    } else {
+        put(w, "false", 5);
+    }
+}
+
+// NUL-terminate and return the document length, or 0 if it did not fit
+size_t json_writer_finish(json_writer_t *w) {
+    if (w->overflow || w->depth != 0) {
+        if (w->cap > 0) {
+            w->buf[0] = '\0';
+        }
+        return 0;
+    }
+    w->buf[w->len] = '\0';
+    return w->len;
+}
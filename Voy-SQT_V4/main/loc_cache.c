@@ -0,0 +1,201 @@
+#include <string.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "loc_cache.h"
+
+static const char *TAG = "loc_cache";
+
+typedef struct {
+    bool valid;
+    uint32_t last_used;         // LRU clock value of the last hit or insert
+    loc_fingerprint_t fingerprint;
+    double latitude;
+    double longitude;
+    double accuracy;
+} loc_cache_entry_t;
+
+static loc_cache_entry_t entries[LOC_CACHE_ENTRIES];
+static uint32_t lru_clock = 0;
+static loc_cache_stats_t stats;
+static SemaphoreHandle_t cache_mutex = NULL;
+
+// FNV-1a, enough to tell a few dozen BSSIDs apart
+static uint32_t hash_mac(const char *mac) {
+    uint32_t h = 2166136261u;
+    for (; *mac; mac++) {
+        h ^= (uint8_t)*mac;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Jaccard similarity in percent, plus the mean RSSI difference on the overlap
+static int similarity(const loc_fingerprint_t *a, const loc_fingerprint_t *b, int *rssi_delta) {
+    int i = 0, j = 0, common = 0, delta = 0;
+    while (i < a->count && j < b->count) {
+        if (a->bssid_hash[i] == b->bssid_hash[j]) {
+            delta += abs(a->rssi[i] - b->rssi[j]);
+            common++;
+            i++;
+            j++;
+        } else if (a->bssid_hash[i] < b->bssid_hash[j]) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    int total = a->count + b->count - common;
+    *rssi_delta = common ? delta / common : 0;
+    return total ? common * 100 / total : 0;
+}
+
+#if LOC_CACHE_PERSIST
+static void load_entries(void) {
+    nvs_handle_t handle;
+    if (nvs_open(LOC_CACHE_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
+    size_t len = sizeof(entries);
+    if (nvs_get_blob(handle, "entries", entries, &len) != ESP_OK || len != sizeof(entries)) {
+        // Missing or from a different layout, start empty
+        memset(entries, 0, sizeof(entries));
+    }
+    nvs_close(handle);
+
+    for (int i = 0; i < LOC_CACHE_ENTRIES; i++) {
+        if (entries[i].valid && entries[i].last_used > lru_clock) {
+            lru_clock = entries[i].last_used;
+        }
+    }
+}
+
+static void save_entries(void) {
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(LOC_CACHE_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, "entries", entries, sizeof(entries));
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to persist cache: %s", esp_err_to_name(err));
+    }
+}
+#endif
+
+// Call after nvs_flash_init()
+esp_err_t loc_cache_init(void) {
+    cache_mutex = xSemaphoreCreateMutex();
+    if (cache_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+#if LOC_CACHE_PERSIST
+    load_entries();
+#endif
+    return ESP_OK;
+}
+
+// Insert one AP, keeping the hashes sorted. Extra APs beyond the limit are ignored.
+void loc_fingerprint_add(loc_fingerprint_t *fp, const char *mac, int rssi) {
+    if (fp->count >= LOC_FINGERPRINT_MAX_APS) {
+        return;
+    }
+    uint32_t h = hash_mac(mac);
+    int i = fp->count;
+    while (i > 0 && fp->bssid_hash[i - 1] > h) {
+        fp->bssid_hash[i] = fp->bssid_hash[i - 1];
+        fp->rssi[i] = fp->rssi[i - 1];
+        i--;
+    }
+    fp->bssid_hash[i] = h;
+    fp->rssi[i] = rssi < INT8_MIN ? INT8_MIN : rssi > INT8_MAX ? INT8_MAX : rssi;
+    fp->count++;
+}
+
+// Return the fix of the most similar cached fingerprint, if close enough
+bool loc_cache_lookup(const loc_fingerprint_t *fp, double *latitude, double *longitude, double *accuracy) {
+    if (cache_mutex == NULL || fp->count == 0) {
+        return false;
+    }
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    loc_cache_entry_t *best = NULL;
+    int best_score = -1;
+    for (int i = 0; i < LOC_CACHE_ENTRIES; i++) {
+        if (!entries[i].valid) {
+            continue;
+        }
+        int rssi_delta;
+        int score = similarity(fp, &entries[i].fingerprint, &rssi_delta);
+        if (score >= LOC_CACHE_MIN_JACCARD && rssi_delta <= LOC_CACHE_RSSI_TOLERANCE && score > best_score) {
+            best = &entries[i];
+            best_score = score;
+        }
+    }
+
+    if (best) {
+        // LRU order is only updated in RAM, a reboot keeps the last saved order
+        best->last_used = ++lru_clock;
+        *latitude = best->latitude;
+        *longitude = best->longitude;
+        *accuracy = best->accuracy;
+        stats.hits++;
+    } else {
+        stats.misses++;
+    }
+    xSemaphoreGive(cache_mutex);
+
+    if (best) {
+        ESP_LOGI(TAG, "Hit, %d%% similar", best_score);
+    }
+    return best != NULL;
+}
+
+// Store a fix from the geolocation API, replacing the least recently used entry
+void loc_cache_insert(const loc_fingerprint_t *fp, double latitude, double longitude, double accuracy) {
+    if (cache_mutex == NULL || fp->count == 0) {
+        return;
+    }
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    loc_cache_entry_t *slot = &entries[0];
+    for (int i = 0; i < LOC_CACHE_ENTRIES; i++) {
+        if (!entries[i].valid) {
+            slot = &entries[i];
+            break;
+        }
+        if (entries[i].last_used < slot->last_used) {
+            slot = &entries[i];
+        }
+    }
+    if (slot->valid) {
+        stats.evictions++;
+    }
+
+    slot->valid = true;
+    slot->last_used = ++lru_clock;
+    slot->fingerprint = *fp;
+    slot->latitude = latitude;
+    slot->longitude = longitude;
+    slot->accuracy = accuracy;
+    stats.inserts++;
+#if LOC_CACHE_PERSIST
+    save_entries();
+#endif
+    xSemaphoreGive(cache_mutex);
+}
+
+void loc_cache_get_stats(loc_cache_stats_t *stats_out) {
+    if (cache_mutex == NULL) {
+        memset(stats_out, 0, sizeof(*stats_out));
+        return;
+    }
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    *stats_out = stats;
+    xSemaphoreGive(cache_mutex);
+}
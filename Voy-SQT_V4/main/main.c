@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
@@ -6,6 +8,7 @@
 #include "esp_mac.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 
 #include "lwip/err.h"
@@ -18,124 +21,291 @@
 #include "wifi.h"
 #include "geolocation.h"
 #include "display.h"
+#include "imu_adc.h"
+#include "imu_ring.h"
+#include "fall_detector.h"
+#include "fall_capture.h"
+#include "telemetry.h"
+#include "report.h"
+#include "event_bus.h"
+#include "batch.h"
+#include "tlog.h"
+#include "loc_cache.h"
+#include "motion.h"
+#include "net.h"
+#include "retry.h"
+#include "wifi_scan.h"
+#include "power.h"
+#include "duty.h"
+#include "sampler.h"
+#include "uptime.h"
+#include "esp_system.h"
+#include "dht.h"
 #include "ssd1306.h"
 
 extern EventGroupHandle_t wifi_event_group;
 
 static const char *TAG = "main";
 
-static int fall_event_count;
-static SemaphoreHandle_t fall_event_mutex;
-
-static int temp_event_count;
-static int hum_event_count;
-static SemaphoreHandle_t temp_hum_event_mutex;
-
-long_lat_t loc;
-bool location_flag = false;
-static SemaphoreHandle_t location_mutex;
+// Pre/post-trigger waveform history and upload slots, too big for a task stack
+static fall_capture_t fall_capture;
+
+// Feed every accelerometer frame into the shared sample ring
+static void imu_frame_to_ring(const imu_frame_t *frame, void *arg) {
+    for (size_t i = 0; i < frame->num_samples; i++) {
+        imu_sample_t sample = {
+            .timestamp_us = (uint32_t)(frame->timestamp_us + (int64_t)i * frame->sample_period_us),
+            .x = frame->samples[i].x,
+            .y = frame->samples[i].y,
+            .z = frame->samples[i].z,
+        };
+        imu_ring_push(&imu_ring, &sample);
+    }
+}
 
 void imu_task(void *pvParameter) {
-    #define FALL_EVENT_COOLDOWN 2000
+    #define IMU_READ_CHUNK 32
 
-    imu_data_t data = read_imu();
-    bool in_cooldown = false;
-    TickType_t last_fall_event_time = 0;
+    imu_ring_reader_t reader;
+    imu_ring_reader_init(&imu_ring, &reader);
+    imu_sample_t samples[IMU_READ_CHUNK];
 
-    // Create mutex for shock counter
-    fall_event_mutex = xSemaphoreCreateMutex();
+    fall_detector_config_t fall_config;
+    fall_detector_default_config(&fall_config);
+    fall_detector_t detector;
+    fall_detector_init(&detector, &fall_config);
+    fall_capture_init(&fall_capture);
+    motion_tracker_t motion;
+    motion_init(&motion, fall_config.counts_per_g);
 
     while (1) {
-        // Measure current IMU data
-        imu_data_t data_new = read_imu();
-
-        // Check for significant change on all axes
-        int eps = 500;
-        bool x_shock = abs(data.x - data_new.x) > eps;
-        bool y_shock = abs(data.y - data_new.y) > eps;
-        bool z_shock = abs(data.z - data_new.z) > eps;
-
-        // Check if fall detected outside of cooldown
-        if (!in_cooldown && (x_shock || y_shock || z_shock)) {
-            // Increment fall event counter
-            if (xSemaphoreTake(fall_event_mutex, 25)) {
-                ESP_LOGI(__func__, "Fall event detected!");
-                fall_event_count++;
-                xSemaphoreGive(fall_event_mutex);
-            }
-            in_cooldown = true;
-            last_fall_event_time = xTaskGetTickCount();
-        }
+        // Run every buffered sample through the fall detector
+        size_t n;
+        while ((n = imu_ring_read(&imu_ring, &reader, samples, IMU_READ_CHUNK)) > 0) {
+            for (size_t i = 0; i < n; i++) {
+                fall_event_t event;
+                fall_state_t prev_state = detector.state;
+                bool fell = fall_detector_update(&detector, &samples[i], &event);
+
+                // Activity drives the WiFi scan schedule
+                motion_update(&motion, &samples[i]);
+
+                // Freeze the waveform around the impact sample
+                fall_capture_push(&fall_capture, &samples[i]);
+                if (prev_state != FALL_STATE_STILLNESS && detector.state == FALL_STATE_STILLNESS) {
+                    fall_capture_trigger(&fall_capture, samples[i].timestamp_us);
+                }
 
-        // Check if cooldown period (5 seconds) has passed
-        if (in_cooldown && (xTaskGetTickCount() - last_fall_event_time >= pdMS_TO_TICKS(FALL_EVENT_COOLDOWN))) {
-            in_cooldown = false;
-        }
+                if (!fell) {
+                    continue;
+                }
 
-        // Push back adc values for next poll
-        data.x = data_new.x;
-        data.y = data_new.y;
-        data.z = data_new.z;
+                ESP_LOGI(__func__, "Fall event detected! free fall %lu ms, peak %lu mg%s",
+                         (unsigned long)event.freefall_ms, (unsigned long)event.peak_mg,
+                         event.settled ? "" : " (did not settle)");
+
+                // Increment fall event counter and wake the uploader
+                telemetry_increment(TELEMETRY_FALL);
+                report_signal_fall();
+
+                event_t bus_event = {
+                    .fall = {
+                        .peak_mg = event.peak_mg,
+                        .freefall_ms = event.freefall_ms,
+                        .settled = event.settled,
+                    },
+                };
+                event_bus_publish(EVENT_FALL, &bus_event);
+            }
+        }
 
-        // Poll every 100ms
-        vTaskDelay(pdMS_TO_TICKS(100));
+        // Ring holds ~2 s of samples, poll well within that
+        sampler_wait(SAMPLER_IMU);
     }
 }
 
 void temp_hum_sensor_task(void *pvParameter) {
-    #define TEMP_H_THRESHOLD 40
-    #define TEMP_L_THRESHOLD 22
-    #define HUM_H_THRESHOLD 45
-    #define HUM_L_THRESHOLD 20
-
     temp_hum_data_t data;
     data.temperature = 25.0;
     data.humidity = 25.0;
 
-    // Create mutex for shock counter
-    temp_hum_event_mutex = xSemaphoreCreateMutex();
-
     while (1) {
         // Measure temperature and humidity
         temp_hum_data_t data_new = read_temp_hum_sensor();
+        event_t temp_event = { .env = { .value = data_new.temperature } };
+        event_t hum_event = { .env = { .value = data_new.humidity } };
 
         // Check for temperature event
         if (data_new.temperature > TEMP_H_THRESHOLD && data.temperature < TEMP_L_THRESHOLD) {
             // Increment temperature event counter
-            if (xSemaphoreTake(temp_hum_event_mutex, 25)) {
-                ESP_LOGI(__func__, "Temperature event detected!");
-                temp_event_count++;
-                xSemaphoreGive(temp_hum_event_mutex);
-            }
+            ESP_LOGI(__func__, "Temperature event detected!");
+            telemetry_increment(TELEMETRY_OVERTEMP);
+            temp_event.env.over_limit = true;
         }
         // Check for humidity event
         if (data_new.humidity > HUM_H_THRESHOLD && data.humidity < HUM_L_THRESHOLD) {
             // Increment humidity event counter
-            if (xSemaphoreTake(temp_hum_event_mutex, 25)) {
-                ESP_LOGI(__func__, "Humidity event detected!");
-                hum_event_count++;
-                xSemaphoreGive(temp_hum_event_mutex);
-            }
+            ESP_LOGI(__func__, "Humidity event detected!");
+            telemetry_increment(TELEMETRY_OVERHUM);
+            hum_event.env.over_limit = true;
         }
+        event_bus_publish(EVENT_TEMP, &temp_event);
+        event_bus_publish(EVENT_HUMIDITY, &hum_event);
 
         // Push back values for next poll
         data.temperature = data_new.temperature;
         data.humidity = data_new.humidity;
 
-        // Poll every 2s
-        vTaskDelay(pdMS_TO_TICKS(2000));
+        // Poll every 2s, on a fixed schedule however long the read took
+        sampler_wait(SAMPLER_TEMP_HUM);
+    }
+}
+
+// Uploads run on the backend network channel. Completion callbacks only
+// record the result and wake http_task, which owns the batch and flash log
+// and applies the result there.
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    bool in_flight;             // Only touched by http_task
+    bool carries_fall;          // Data includes a fall record, completes the pending alert
+    atomic_bool done;
+    esp_err_t result;
+} upload_job_t;
+
+static upload_job_t batch_job;
+static upload_job_t drain_job;
+
+static esp_err_t upload_run(void *ctx) {
+    upload_job_t *job = (upload_job_t *)ctx;
+    return send_batch_request(job->data, job->len, batch_content_type());
+}
+
+static void upload_done(esp_err_t err, void *ctx) {
+    upload_job_t *job = (upload_job_t *)ctx;
+    job->result = err;
+    atomic_store(&job->done, true);
+    report_signal_net_done();
+}
+
+static bool upload_submit(upload_job_t *job, const uint8_t *data, size_t len) {
+    // Nothing could be encoded, e.g. the flash log failed to read
+    if (len == 0) {
+        return false;
+    }
+    job->data = data;
+    job->len = len;
+    atomic_store(&job->done, false);
+    job->in_flight = net_submit(NET_CHANNEL_BACKEND, upload_run, upload_done, job) == ESP_OK;
+    return job->in_flight;
+}
+
+// True once, when a submitted job has finished
+static bool upload_finished(upload_job_t *job) {
+    if (!job->in_flight || !atomic_load(&job->done)) {
+        return false;
+    }
+    job->in_flight = false;
+    return true;
+}
+
+static esp_err_t waveform_run(void *ctx) {
+    fall_capture_blob_t *blob = (fall_capture_blob_t *)ctx;
+    return send_waveform_request(blob->data, blob->len);
+}
+
+static void waveform_done(esp_err_t err, void *ctx) {
+    fall_capture_blob_t *blob = (fall_capture_blob_t *)ctx;
+    // Refused by the backend retry policy without being sent, keep it for later
+    if (err == ESP_ERR_INVALID_STATE && xQueueSendToFront(fall_capture_queue, &blob, 0) == pdPASS) {
+        return;
+    }
+    fall_capture_release(blob);
+}
+
+// Apply finished uploads, then start a backlog drain if one is due
+static void collect_uploads(void) {
+    if (upload_finished(&batch_job)) {
+        if (batch_job.result == ESP_OK) {
+            batch_commit(batch_job.len);
+            if (batch_job.carries_fall) {
+                report_complete_alert();
+            }
+            batch_log_stats();
+        } else if (batch_job.result == ESP_ERR_INVALID_RESPONSE) {
+            // Refused for good, resending it would only be refused again
+            batch_reject();
+        } else if (retry_get_state(&backend_retry) != RETRY_CLOSED) {
+            // Backend down, keep the data in flash instead of in RAM
+            batch_spill();
+        }
+        // Otherwise the records stay queued and go out once the backoff expires
+    }
+
+    if (upload_finished(&drain_job)) {
+        if (drain_job.result == ESP_OK) {
+            // A fall spilled to flash while offline is delivered here
+            if (drain_job.carries_fall) {
+                report_complete_alert();
+            }
+            tlog_commit();
+            ESP_LOGI(__func__, "Backlog drained, %lu records left", (unsigned long)tlog_pending());
+        } else if (drain_job.result == ESP_ERR_INVALID_RESPONSE) {
+            tlog_reject();
+        } else {
+            tlog_abort();
+        }
+    }
+
+    // Upload one capped batch of records stored while offline
+    if (!drain_job.in_flight && tlog_should_drain() && retry_delay_ms(&backend_retry) == 0) {
+        static uint8_t drain_buf[TLOG_BUFFER_SIZE];
+        size_t len = tlog_encode(drain_buf, sizeof(drain_buf));
+        drain_job.carries_fall = tlog_encoded_falls() > 0;
+        if (!upload_submit(&drain_job, drain_buf, len)) {
+            tlog_abort();
+        }
     }
 }
 
 void http_task(void *pvParameter) {
+    const TickType_t coalesce_period = pdMS_TO_TICKS(REPORT_COALESCE_MS);
+    TickType_t last_flush = xTaskGetTickCount();
+    // An urgent flush that found the previous batch still in flight
+    bool urgent_pending = false;
+
+    // Counters come from telemetry (never lossy), locations from the bus
+    event_sub_t sub;
+    event_bus_subscribe(&sub, EVENT_MASK(EVENT_LOCATION), NULL);
+
     while (1) {
+        // Sleep until a fall alert arrives, an upload finishes or the next
+        // coalesced flush is due, waking in between to drain a flash backlog
+        TickType_t since_flush = xTaskGetTickCount() - last_flush;
+        TickType_t wait = since_flush < coalesce_period ? coalesce_period - since_flush : 0;
+        if (tlog_pending() > 0 && wait > pdMS_TO_TICKS(TLOG_DRAIN_INTERVAL_MS)) {
+            wait = pdMS_TO_TICKS(TLOG_DRAIN_INTERVAL_MS);
+        }
+        // A held back fall alert goes out as soon as the backoff allows
+        if (urgent_pending && !batch_job.in_flight) {
+            TickType_t backoff = pdMS_TO_TICKS(retry_delay_ms(&backend_retry));
+            wait = backoff < wait ? backoff : wait;
+        }
+        EventBits_t bits = report_wait(wait);
+        collect_uploads();
+        bool link_ready = retry_delay_ms(&backend_retry) == 0;
+        bool urgent_wake = (bits & REPORT_URGENT_BITS) || (urgent_pending && !batch_job.in_flight && link_ready);
+        if (!urgent_wake && xTaskGetTickCount() - last_flush < coalesce_period) {
+            continue;
+        }
+        last_flush = xTaskGetTickCount();
 
         // IMU data
-        int fall_event_count_out = 0;
+        int fall_event_count_out = telemetry_take(TELEMETRY_FALL);
 
         // Temperature and humidity data
-        int temp_event_count_out = 0;
-        int hum_event_count_out = 0;
+        int temp_event_count_out = telemetry_take(TELEMETRY_OVERTEMP);
+        int hum_event_count_out = telemetry_take(TELEMETRY_OVERHUM);
 
         // Location data
         double longitude_out = 0.0;
@@ -143,71 +313,109 @@ void http_task(void *pvParameter) {
         bool location_flag_out = false;
         
         // Check for fall events
-        if (xSemaphoreTake(fall_event_mutex, 25)) {
-            if (fall_event_count != 0) {
-                ESP_LOGI(__func__, "Detected %i fall events", fall_event_count);
-                fall_event_count_out = fall_event_count;
-                fall_event_count = 0;
-            }
-            xSemaphoreGive(fall_event_mutex);
+        if (fall_event_count_out != 0) {
+            ESP_LOGI(__func__, "Detected %i fall events", fall_event_count_out);
         }
         // Check for temperature/humidity events
-        if (xSemaphoreTake(temp_hum_event_mutex, 25)) {
-            if (temp_event_count != 0) {
-                ESP_LOGI(__func__, "Detected %i overtemp events", temp_event_count);
-                temp_event_count_out = temp_event_count;
-                temp_event_count = 0;
-            }
-            if (hum_event_count != 0) {
-                ESP_LOGI(__func__, "Detected %i overtemp events", hum_event_count);
-                hum_event_count_out = hum_event_count;
-                hum_event_count = 0;
-            }
-            xSemaphoreGive(temp_hum_event_mutex);
+        if (temp_event_count_out != 0) {
+            ESP_LOGI(__func__, "Detected %i overtemp events", temp_event_count_out);
+        }
+        if (hum_event_count_out != 0) {
+            ESP_LOGI(__func__, "Detected %i overhum events", hum_event_count_out);
         }
 
-        // Check for location updates
-        if (xSemaphoreTake(location_mutex, 25)) {
-            location_flag_out = location_flag;
-            if (location_flag) {
-                ESP_LOGI(__func__, "Location updated");
-                location_flag = false;
-                longitude_out = loc.longitude;
-                latitude_out = loc.latitude;
-            }
-            xSemaphoreGive(location_mutex);
-        }          
+        // Check for location updates, keep the newest
+        event_t event;
+        while (event_bus_read(&sub, &event)) {
+            location_flag_out = true;
+            longitude_out = event.location.longitude;
+            latitude_out = event.location.latitude;
+        }
+        if (location_flag_out) {
+            ESP_LOGI(__func__, "Location updated");
+        }
         
-        // Send log if any events/updates detected
+        // Queue a snapshot if any events/updates detected
         if ((fall_event_count_out + temp_event_count_out + hum_event_count_out != 0) || location_flag_out) {
-            send_post_request(fall_event_count_out, temp_event_count_out, hum_event_count_out, longitude_out, latitude_out);
+            batch_record_t record = {
+                .timestamp_us = uptime_us(),
+                .fall_events = fall_event_count_out,
+                .overtemp_events = temp_event_count_out,
+                .overhum_events = hum_event_count_out,
+                .has_location = location_flag_out,
+                .longitude = longitude_out,
+                .latitude = latitude_out,
+            };
+            batch_add(&record);
+        }
+
+        // Fall alerts go out right away, routine data waits for the batch to fill or age.
+        // A batch already in flight goes first; its completion wakes this task again.
+        // While the backend is backing off everything waits for the retry policy.
+        bool urgent = urgent_wake || fall_event_count_out != 0;
+        bool blocked = batch_job.in_flight || !link_ready;
+        urgent_pending = blocked && (urgent || urgent_pending);
+        if (!blocked && batch_should_flush(urgent)) {
+            static uint8_t batch_buf[BATCH_BUFFER_SIZE];
+            size_t len = batch_encode(batch_buf, sizeof(batch_buf));
+            batch_job.carries_fall = batch_encoded_falls() > 0;
+            if (!upload_submit(&batch_job, batch_buf, len)) {
+                batch_spill();
+            }
         }
 
-        // Check every 5s
-        vTaskDelay(pdMS_TO_TICKS(5000));
+        // Upload any captured fall waveforms alongside the counters
+        fall_capture_blob_t *blob = NULL;
+        while (link_ready && fall_capture_queue && xQueuePeek(fall_capture_queue, &blob, 0) == pdPASS) {
+            if (net_submit(NET_CHANNEL_BACKEND, waveform_run, waveform_done, blob) != ESP_OK) {
+                // Channel busy, try again on the next flush
+                break;
+            }
+            xQueueReceive(fall_capture_queue, &blob, 0);
+        }
     }
 }
 
-void geolocation_task(void *pvParameter) {
+// Geolocation requests in flight or waiting on the geolocation channel
+#define GEO_REQUEST_SLOTS 2
 
-    // Create mutex for shock counter
-    location_mutex = xSemaphoreCreateMutex();
+typedef struct {
+    atomic_bool in_use;
+    wifi_scan_json_t scan;
+    long_lat_t loc;
+} geo_request_t;
 
-    while (1) {
-        
-        char *received_json = NULL;
-        if (xQueueReceive(wifi_json_queue, &received_json, portMAX_DELAY) == pdPASS) {
-            ESP_LOGI(__func__, "Received JSON data:");
-            if (xSemaphoreTake(location_mutex, 25)) {
-                location_flag = true;
-                loc = process_geolocation_json(received_json);
-                xSemaphoreGive(location_mutex);
-            }          
-        }
+static geo_request_t geo_requests[GEO_REQUEST_SLOTS];
 
-        // Check every 30s
-        vTaskDelay(pdMS_TO_TICKS(30000));
+static esp_err_t geolocation_run(void *ctx) {
+    geo_request_t *req = (geo_request_t *)ctx;
+    return process_geolocation_json(req->scan.json, req->scan.len, &req->loc) ? ESP_OK : ESP_FAIL;
+}
+
+static void geolocation_done(esp_err_t err, void *ctx) {
+    geo_request_t *req = (geo_request_t *)ctx;
+    if (err == ESP_OK) {
+        loc_cache_insert(&req->scan.fingerprint, req->loc.latitude, req->loc.longitude, req->loc.accuracy);
+        event_t event = {
+            .location = {
+                .latitude = req->loc.latitude,
+                .longitude = req->loc.longitude,
+                .accuracy = req->loc.accuracy,
+            },
+        };
+        event_bus_publish(EVENT_LOCATION, &event);
+    }
+    atomic_store(&req->in_use, false);
+}
+
+static geo_request_t *claim_geo_request(void) {
+    for (int i = 0; i < GEO_REQUEST_SLOTS; i++) {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&geo_requests[i].in_use, &expected, true)) {
+            return &geo_requests[i];
+        }
     }
+    return NULL;
 }
 
 void wifi_scan_task(void *pvParameter) {
@@ -221,18 +429,39 @@ void wifi_scan_task(void *pvParameter) {
         wifi_ap_t *wifi_aps = create_wifi_aps_array(&num_aps);
 
         if (wifi_aps && num_aps > 0) {
-            char *json_str = generate_wifi_scan_json(wifi_aps, num_aps);
-            if (json_str) {
-                ESP_LOGI(__func__, "Generated scan JSON");
-
-                // Send the JSON pointer via the queue.
-                if (xQueueSend(wifi_json_queue, &json_str, pdMS_TO_TICKS(100)) != pdPASS) {
-                    ESP_LOGE("wifi_scan_task", "Failed to send JSON to queue; freeing json_str");
-                    free(json_str);
-                }
-            } 
+            loc_fingerprint_t fingerprint = {0};
+            for (size_t i = 0; i < num_aps; i++) {
+                loc_fingerprint_add(&fingerprint, wifi_aps[i].mac, wifi_aps[i].signal_strength);
+            }
+
+            // Same surroundings as a cached fix, skip the API request
+            event_t event;
+            geo_request_t *req;
+            if (loc_cache_lookup(&fingerprint, &event.location.latitude,
+                                 &event.location.longitude, &event.location.accuracy)) {
+                ESP_LOGI(__func__, "Location from cache");
+                event_bus_publish(EVENT_LOCATION, &event);
+            }
+            else if (retry_delay_ms(&geo_retry) > 0) {
+                ESP_LOGI(__func__, "Geolocation %s, skipping request", retry_state_name(retry_get_state(&geo_retry)));
+            }
+            else if ((req = claim_geo_request()) == NULL) {
+                // Earlier requests still waiting on the API, this scan adds nothing
+                ESP_LOGW(__func__, "Geolocation requests busy, dropping scan");
+            }
             else {
-                ESP_LOGE(__func__, "Failed to generate JSON payload.");
+                req->scan.fingerprint = fingerprint;
+                req->scan.len = generate_wifi_scan_json(wifi_aps, num_aps, req->scan.json, sizeof(req->scan.json));
+                if (req->scan.len == 0) {
+                    ESP_LOGE(__func__, "Failed to generate JSON payload.");
+                    atomic_store(&req->in_use, false);
+                }
+                else if (net_submit(NET_CHANNEL_GEOLOCATION, geolocation_run, geolocation_done, req) != ESP_OK) {
+                    atomic_store(&req->in_use, false);
+                }
+                else {
+                    ESP_LOGI(__func__, "Generated scan JSON");
+                }
             }
             free(wifi_aps);
         } 
@@ -240,8 +469,10 @@ void wifi_scan_task(void *pvParameter) {
             ESP_LOGI(__func__, "No WiFi access points detected.");
         }
 
-        // Scan every 120s
-        vTaskDelay(pdMS_TO_TICKS(120000));
+        // Skip scans while stationary, rescan once a movement ends
+        motion_scan_reason_t reason = motion_wait_scan_slot();
+        ESP_LOGI(__func__, "Scanning (%s)", reason == MOTION_SCAN_SETTLED ? "movement ended" :
+                 reason == MOTION_SCAN_MOVING ? "moving" : "idle");
     }
 }
 
@@ -254,25 +485,28 @@ void display_task(void *pvParameter) {
     vTaskDelay(pdMS_TO_TICKS(3000));
     ssd1306_clear_screen(&disp, false);
 
+    event_sub_t sub;
+    event_bus_subscribe(&sub, EVENT_MASK(EVENT_FALL) | EVENT_MASK(EVENT_TEMP) | EVENT_MASK(EVENT_HUMIDITY), NULL);
+
     while (1) {
+        // Collect alerts since the last refresh
+        bool fall = false, hot = false, wet = false;
+        event_t event;
+        while (event_bus_read(&sub, &event)) {
+            fall |= event.type == EVENT_FALL;
+            hot |= event.type == EVENT_TEMP && event.env.over_limit;
+            wet |= event.type == EVENT_HUMIDITY && event.env.over_limit;
+        }
+
         // Check for fall events
-        if (xSemaphoreTake(fall_event_mutex, 25)) {
-            if (fall_event_count != 0) {
-                ssd1306_display_text_x3(&disp, 0, "Fall!", 5, false);
-            }
-            xSemaphoreGive(fall_event_mutex);
+        if (fall) {
+            ssd1306_display_text_x3(&disp, 0, "Fall!", 5, false);
             vTaskDelay(pdMS_TO_TICKS(3000));
             ssd1306_clear_screen(&disp, false);
         }
         // Check for temperature/humidity events
-        if (xSemaphoreTake(temp_hum_event_mutex, 25)) {
-            if (temp_event_count != 0) {
-                ssd1306_display_text_x3(&disp, 0, "Hot!", 5, false);
-            }
-            else if (hum_event_count != 0) {
-                ssd1306_display_text_x3(&disp, 0, "Wet!", 5, false);
-            }
-            xSemaphoreGive(temp_hum_event_mutex);
+        if (hot || wet) {
+            ssd1306_display_text_x3(&disp, 0, hot ? "Hot!" : "Wet!", 5, false);
             vTaskDelay(pdMS_TO_TICKS(3000));
             ssd1306_clear_screen(&disp, false);
         }
@@ -280,8 +514,114 @@ void display_task(void *pvParameter) {
     }
 }
 
+void log_task(void *pvParameter) {
+    #define HEALTH_PERIOD_MS 60000
+
+    event_sub_t sub;
+    event_bus_subscribe(&sub, EVENT_MASK_ALL, NULL);
+    TickType_t last_health = xTaskGetTickCount();
+
+    while (1) {
+        // Local log of everything on the bus
+        event_t event;
+        while (event_bus_read(&sub, &event)) {
+            switch (event.type) {
+                case EVENT_FALL:
+                    ESP_LOGI(__func__, "[%lld] fall peak=%lumg freefall=%ums settled=%d",
+                             event.timestamp_us, (unsigned long)event.fall.peak_mg,
+                             event.fall.freefall_ms, event.fall.settled);
+                    break;
+                case EVENT_TEMP:
+                case EVENT_HUMIDITY:
+                    ESP_LOGD(__func__, "[%lld] %s=%.1f%s", event.timestamp_us,
+                             event.type == EVENT_TEMP ? "temp" : "hum", event.env.value,
+                             event.env.over_limit ? " (alert)" : "");
+                    break;
+                case EVENT_LOCATION:
+                    ESP_LOGI(__func__, "[%lld] location lat=%f lng=%f acc=%.0fm", event.timestamp_us,
+                             event.location.latitude, event.location.longitude, event.location.accuracy);
+                    break;
+                case EVENT_HEALTH:
+                    ESP_LOGI(__func__, "[%lld] health heap=%lu min=%lu dht_crit=%luus loc_cache=%lu/%lu "
+                             "backend=%s (%lu refused) geo=%s (%lu refused)", event.timestamp_us,
+                             (unsigned long)event.health.free_heap, (unsigned long)event.health.min_free_heap,
+                             (unsigned long)event.health.dht_max_critical_us,
+                             (unsigned long)event.health.loc_cache_hits,
+                             (unsigned long)event.health.loc_cache_misses,
+                             retry_state_name(event.health.backend_link), (unsigned long)event.health.backend_refused,
+                             retry_state_name(event.health.geo_link), (unsigned long)event.health.geo_refused);
+                    ESP_LOGI(__func__, "[%lld] wifi boot_to_ip=%lums reconnects=%lu last=%lums scan=%lums", event.timestamp_us,
+                             (unsigned long)event.health.wifi_cold_boot_ms, (unsigned long)event.health.wifi_reconnects,
+                             (unsigned long)event.health.wifi_reconnect_ms, (unsigned long)event.health.wifi_scan_ms);
+                    break;
+                default:
+                    break;
+            }
+        }
+        if (sub.overflows) {
+            ESP_LOGW(__func__, "Log subscriber missed %lu events", (unsigned long)sub.overflows);
+            sub.overflows = 0;
+        }
+
+        // Periodic health snapshot
+        if (xTaskGetTickCount() - last_health >= pdMS_TO_TICKS(HEALTH_PERIOD_MS)) {
+            last_health = xTaskGetTickCount();
+            dht_critical_stats_t dht_stats;
+            dht_get_critical_stats(&dht_stats);
+            loc_cache_stats_t cache_stats;
+            loc_cache_get_stats(&cache_stats);
+            retry_stats_t backend_stats, geo_stats;
+            retry_get_stats(&backend_retry, &backend_stats);
+            retry_get_stats(&geo_retry, &geo_stats);
+            wifi_stats_t wifi_stats;
+            wifi_get_stats(&wifi_stats);
+            wifi_scan_stats_t scan_stats;
+            wifi_scan_get_stats(&scan_stats);
+            event_t health = {
+                .health = {
+                    .free_heap = esp_get_free_heap_size(),
+                    .min_free_heap = esp_get_minimum_free_heap_size(),
+                    .dht_max_critical_us = dht_stats.max_us,
+                    .loc_cache_hits = cache_stats.hits,
+                    .loc_cache_misses = cache_stats.misses,
+                    .backend_link = retry_get_state(&backend_retry),
+                    .geo_link = retry_get_state(&geo_retry),
+                    .backend_refused = backend_stats.refused,
+                    .geo_refused = geo_stats.refused,
+                    .wifi_cold_boot_ms = wifi_stats.cold_boot_ms,
+                    .wifi_reconnect_ms = wifi_stats.last_reconnect_ms,
+                    .wifi_reconnects = wifi_stats.reconnects,
+                    .wifi_scan_ms = scan_stats.last_ms,
+                },
+            };
+            event_bus_publish(EVENT_HEALTH, &health);
+            power_log_report();
+            sampler_log_report();
+        }
+
+        sampler_wait(SAMPLER_LOG);
+    }
+}
+
 void app_main() {
+    power_init();
     io_pins_init();
+
+#if DUTY_CYCLE_MODE
+    // Sample, maybe upload, deep sleep. Skips the always-on tasks below.
+    xTaskCreate(duty_cycle_task, "Duty_Task", DUTY_TASK_STACK, NULL, DUTY_TASK_PRIO, NULL);
+    return;
+#endif
+
+    // Start continuous accelerometer sampling
+    imu_adc_config_t imu_config = {
+        .sample_rate_hz = IMU_ADC_DEFAULT_RATE_HZ,
+        .on_frame = imu_frame_to_ring,
+    };
+    if (imu_adc_start(&imu_config) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start IMU sampling");
+    }
+    temp_hum_sensor_init();
     vTaskDelay(pdMS_TO_TICKS(250));
 
     // Run self-test before starting tasks
@@ -298,19 +638,24 @@ void app_main() {
     }
     ESP_ERROR_CHECK(ret);
 
+    // Store-and-forward log for telemetry that could not be uploaded
+    tlog_init();
+    loc_cache_init();
+
     ESP_LOGI(TAG, "Initializing WiFi");
     wifi_init_sta();
 
-    wifi_json_queue = xQueueCreate(5, sizeof(char *));
-    if (wifi_json_queue == NULL) {
-        ESP_LOGE(TAG, "Failed to create wifi_json_queue");
-    }
+    report_init();
+    retry_init(&backend_retry, "backend");
+    retry_init(&geo_retry, "geolocation");
+    net_init();
+    ESP_ERROR_CHECK(sampler_init());
 
     ESP_LOGI(TAG, "Initializing RTOS tasks");
-    xTaskCreate(imu_task, "IMU_Task", 2048, NULL, 2, NULL);
+    xTaskCreate(imu_task, "IMU_Task", 4096, NULL, 2, NULL);
     xTaskCreate(temp_hum_sensor_task, "Temp_Hum_Task", 4096, NULL, 3, NULL);
     xTaskCreate(wifi_scan_task, "WiFi_Scan_Task", 2048, NULL, 4, NULL);
-    xTaskCreate(geolocation_task, "Geolocation_Task", 4096, NULL, 5, NULL);
     xTaskCreate(http_task, "HTTP_Task", 4096, NULL, 6, NULL);
     xTaskCreate(display_task, "Display_Task", 8196, NULL, 7, NULL);
+    xTaskCreate(log_task, "Log_Task", 3072, NULL, 1, NULL);
 }
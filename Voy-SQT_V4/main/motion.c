@@ -0,0 +1,117 @@
+#include <string.h>
+#include "esp_log.h"
+#include "motion.h"
+
+static const char *TAG = "motion";
+
+static EventGroupHandle_t motion_events = NULL;
+static motion_stats_t stats;
+
+// Only touched by the scanning task
+static TickType_t idle_interval = pdMS_TO_TICKS(MOTION_SCAN_IDLE_MIN_MS);
+
+void motion_init(motion_tracker_t *tracker, int16_t counts_per_g) {
+    memset(tracker, 0, sizeof(*tracker));
+    tracker->activity_counts = MOTION_ACTIVITY_MG * counts_per_g / 1000;
+
+    if (motion_events == NULL) {
+        motion_events = xEventGroupCreate();
+    }
+}
+
+// Feed one sample, called for every sample from the IMU task
+void motion_update(motion_tracker_t *tracker, const imu_sample_t *sample) {
+    int32_t axes[3] = { sample->x, sample->y, sample->z };
+    int32_t deviation = 0;
+
+    // Slow per-axis baseline tracks gravity and orientation, the rest is activity
+    for (int i = 0; i < 3; i++) {
+        if (!tracker->primed) {
+            tracker->baseline[i] = axes[i] << MOTION_BASELINE_SHIFT;
+        }
+        int32_t base = tracker->baseline[i] >> MOTION_BASELINE_SHIFT;
+        int32_t d = axes[i] - base;
+        deviation += d < 0 ? -d : d;
+        tracker->baseline[i] += d;
+    }
+    tracker->primed = true;
+
+    uint32_t now = sample->timestamp_us;
+    if (deviation >= tracker->activity_counts) {
+        tracker->last_active_us = now;
+        if (!tracker->moving) {
+            tracker->moving = true;
+            tracker->moving_since_us = now;
+            if (motion_events) {
+                xEventGroupSetBits(motion_events, MOTION_MOVING_BIT);
+            }
+        }
+        return;
+    }
+
+    if (tracker->moving && now - tracker->last_active_us >= (uint32_t)MOTION_STILL_MS * 1000) {
+        tracker->moving = false;
+        uint32_t duration_ms = (tracker->last_active_us - tracker->moving_since_us) / 1000;
+        if (motion_events) {
+            xEventGroupClearBits(motion_events, MOTION_MOVING_BIT);
+            if (duration_ms >= MOTION_SIGNIFICANT_MS) {
+                stats.movements++;
+                xEventGroupSetBits(motion_events, MOTION_SETTLED_BIT);
+            }
+        }
+        ESP_LOGI(TAG, "Stopped after %lu ms of movement", (unsigned long)duration_ms);
+    }
+}
+
+// Block until the next WiFi scan should run. Stationary: wait, with an
+// interval that doubles up to MOTION_SCAN_IDLE_MAX_MS. Moving: scan every
+// MOTION_SCAN_MOVING_MS. A significant movement ending scans right away.
+motion_scan_reason_t motion_wait_scan_slot(void) {
+    motion_scan_reason_t reason;
+
+    if (motion_events == NULL) {
+        // No motion input, fall back to the fixed moving cadence
+        vTaskDelay(pdMS_TO_TICKS(MOTION_SCAN_MOVING_MS));
+        reason = MOTION_SCAN_MOVING;
+        stats.scans[reason]++;
+        return reason;
+    }
+
+    while (1) {
+        if (xEventGroupGetBits(motion_events) & MOTION_MOVING_BIT) {
+            idle_interval = pdMS_TO_TICKS(MOTION_SCAN_IDLE_MIN_MS);
+            EventBits_t bits = xEventGroupWaitBits(motion_events, MOTION_SETTLED_BIT, pdTRUE, pdFALSE,
+                                                   pdMS_TO_TICKS(MOTION_SCAN_MOVING_MS));
+            reason = (bits & MOTION_SETTLED_BIT) ? MOTION_SCAN_SETTLED : MOTION_SCAN_MOVING;
+            break;
+        }
+
+        EventBits_t bits = xEventGroupWaitBits(motion_events, MOTION_SETTLED_BIT | MOTION_MOVING_BIT,
+                                               pdFALSE, pdFALSE, idle_interval);
+        if (bits & MOTION_SETTLED_BIT) {
+            xEventGroupClearBits(motion_events, MOTION_SETTLED_BIT);
+            idle_interval = pdMS_TO_TICKS(MOTION_SCAN_IDLE_MIN_MS);
+            reason = MOTION_SCAN_SETTLED;
+            break;
+        }
+        if (bits & MOTION_MOVING_BIT) {
+            // Started moving, switch to the moving cadence
+            continue;
+        }
+
+        // Still stationary, back off further
+        reason = MOTION_SCAN_IDLE;
+        idle_interval *= 2;
+        if (idle_interval > pdMS_TO_TICKS(MOTION_SCAN_IDLE_MAX_MS)) {
+            idle_interval = pdMS_TO_TICKS(MOTION_SCAN_IDLE_MAX_MS);
+        }
+        break;
+    }
+
+    stats.scans[reason]++;
+    return reason;
+}
+
+void motion_get_stats(motion_stats_t *stats_out) {
+    *stats_out = stats;
+}
@@ -0,0 +1,102 @@
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "net.h"
+#include "power.h"
+
+static const char *TAG = "net";
+
+typedef struct {
+    net_run_fn_t run;
+    net_done_fn_t done;
+    void *ctx;
+} net_request_t;
+
+typedef struct {
+    QueueHandle_t requests;
+    _Atomic uint32_t submitted;
+    _Atomic uint32_t rejected;
+    _Atomic uint32_t completed;
+    _Atomic uint32_t failed;
+} net_channel_state_t;
+
+static net_channel_state_t channels[NET_NUM_CHANNELS];
+
+static const char *const channel_names[NET_NUM_CHANNELS] = {
+    [NET_CHANNEL_BACKEND] = "Net_Backend",
+    [NET_CHANNEL_GEOLOCATION] = "Net_Geo",
+};
+
+// One worker per channel, runs requests in submission order
+static void net_task(void *pvParameter) {
+    net_channel_state_t *channel = (net_channel_state_t *)pvParameter;
+    net_request_t request;
+
+    while (1) {
+        if (xQueueReceive(channel->requests, &request, portMAX_DELAY) != pdPASS) {
+            continue;
+        }
+        // Full CPU speed for the TLS handshake and request, DFS again after
+        power_lock_acquire(POWER_LOCK_NET);
+        esp_err_t err = request.run(request.ctx);
+        power_lock_release(POWER_LOCK_NET);
+        if (err != ESP_OK) {
+            atomic_fetch_add(&channel->failed, 1);
+        }
+        if (request.done) {
+            request.done(err, request.ctx);
+        }
+        atomic_fetch_add(&channel->completed, 1);
+    }
+}
+
+esp_err_t net_init(void) {
+    for (int i = 0; i < NET_NUM_CHANNELS; i++) {
+        channels[i].requests = xQueueCreate(NET_QUEUE_DEPTH, sizeof(net_request_t));
+        if (channels[i].requests == NULL) {
+            ESP_LOGE(TAG, "Failed to create %s queue", channel_names[i]);
+            return ESP_ERR_NO_MEM;
+        }
+        if (xTaskCreate(net_task, channel_names[i], NET_TASK_STACK, &channels[i], NET_TASK_PRIO, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to start %s", channel_names[i]);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+// Queue a request without blocking. ctx must stay valid until done runs.
+esp_err_t net_submit(net_channel_t channel, net_run_fn_t run, net_done_fn_t done, void *ctx) {
+    if (channel >= NET_NUM_CHANNELS || run == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    net_channel_state_t *state = &channels[channel];
+    if (state->requests == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    net_request_t request = {
+        .run = run,
+        .done = done,
+        .ctx = ctx,
+    };
+    // Count before queueing so completed never overtakes submitted
+    atomic_fetch_add(&state->submitted, 1);
+    if (xQueueSend(state->requests, &request, 0) != pdPASS) {
+        atomic_fetch_sub(&state->submitted, 1);
+        atomic_fetch_add(&state->rejected, 1);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void net_get_stats(net_channel_t channel, net_stats_t *stats_out) {
+    net_channel_state_t *state = &channels[channel];
+    stats_out->submitted = atomic_load(&state->submitted);
+    stats_out->rejected = atomic_load(&state->rejected);
+    stats_out->completed = atomic_load(&state->completed);
+    stats_out->failed = atomic_load(&state->failed);
+    stats_out->in_flight = stats_out->submitted - stats_out->completed;
+}
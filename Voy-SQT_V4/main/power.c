@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_pm.h"
+#include "power.h"
+
+static const char *TAG = "power";
+
+typedef struct {
+    const char *name;
+    esp_pm_lock_type_t type;
+    esp_pm_lock_handle_t handle;
+    uint32_t holders;           // Tasks holding it right now
+    int64_t acquired_at_us;     // When holders went from 0 to 1
+    power_lock_stats_t stats;
+} power_lock_state_t;
+
+// Both network workers can hold the net lock at once, hold time counts
+// while anyone holds it
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static power_lock_state_t locks[POWER_NUM_LOCKS] = {
+    [POWER_LOCK_SENSOR] = { .name = "sensor", .type = ESP_PM_NO_LIGHT_SLEEP },
+    [POWER_LOCK_NET] = { .name = "net", .type = ESP_PM_CPU_FREQ_MAX },
+};
+
+// Call early in app_main, before drivers that take their own PM locks
+esp_err_t power_init(void) {
+#if CONFIG_PM_ENABLE
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = POWER_MAX_FREQ_MHZ,
+        .min_freq_mhz = POWER_MIN_FREQ_MHZ,
+        .light_sleep_enable = POWER_LIGHT_SLEEP,
+    };
+    esp_err_t err = esp_pm_configure(&pm_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure power management: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    for (int i = 0; i < POWER_NUM_LOCKS; i++) {
+        err = esp_pm_lock_create(locks[i].type, 0, locks[i].name, &locks[i].handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create %s lock: %s", locks[i].name, esp_err_to_name(err));
+            return err;
+        }
+    }
+    ESP_LOGI(TAG, "DFS %d-%d MHz, light sleep %s", POWER_MIN_FREQ_MHZ, POWER_MAX_FREQ_MHZ,
+             POWER_LIGHT_SLEEP ? "on" : "off");
+    return ESP_OK;
+#else
+    ESP_LOGW(TAG, "CONFIG_PM_ENABLE is off, running at a fixed frequency");
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+void power_lock_acquire(power_lock_t lock) {
+    power_lock_state_t *state = &locks[lock];
+    if (state->handle) {
+        esp_pm_lock_acquire(state->handle);
+    }
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&stats_lock);
+    if (state->holders++ == 0) {
+        state->acquired_at_us = now;
+    }
+    state->stats.acquires++;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+void power_lock_release(power_lock_t lock) {
+    power_lock_state_t *state = &locks[lock];
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&stats_lock);
+    if (state->holders > 0 && --state->holders == 0) {
+        state->stats.held_us += now - state->acquired_at_us;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+    if (state->handle) {
+        esp_pm_lock_release(state->handle);
+    }
+}
+
+void power_get_lock_stats(power_lock_t lock, power_lock_stats_t *stats_out) {
+    portENTER_CRITICAL(&stats_lock);
+    *stats_out = locks[lock].stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+// Time spent in each power mode (CPU max, APB max, APB min, light sleep)
+// and per-lock hold times. The mode table needs CONFIG_PM_PROFILING.
+// Driver locks show up in the dump too: the continuous ADC holds
+// APB_FREQ_MAX while the IMU samples, and the DHT RMT channel holds one
+// only for the length of each read.
+void power_log_report(void) {
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < POWER_NUM_LOCKS; i++) {
+        power_lock_stats_t stats;
+        power_get_lock_stats(i, &stats);
+        ESP_LOGI(TAG, "Lock %s: %lu acquires, held %llu ms (%.2f%% of uptime)", locks[i].name,
+                 (unsigned long)stats.acquires, (unsigned long long)(stats.held_us / 1000),
+                 now > 0 ? 100.0 * stats.held_us / now : 0.0);
+    }
+#if CONFIG_PM_ENABLE && CONFIG_PM_PROFILING
+    esp_pm_dump_locks(stdout);
+#endif
+}
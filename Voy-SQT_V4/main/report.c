@@ -0,0 +1,69 @@
+#include <stdatomic.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "report.h"
+
+static const char *TAG = "report";
+
+static EventGroupHandle_t report_event_group = NULL;
+
+// Detection time of the oldest alert not yet uploaded, 0 if none pending
+static _Atomic int64_t pending_alert_us;
+
+static portMUX_TYPE latency_mux = portMUX_INITIALIZER_UNLOCKED;
+static report_latency_t latency;
+
+void report_init(void) {
+    report_event_group = xEventGroupCreate();
+    if (report_event_group == NULL) {
+        ESP_LOGE(TAG, "Failed to create report_event_group");
+    }
+}
+
+// Called by the detector, wakes the uploader right away
+void report_signal_fall(void) {
+    int64_t expected = 0;
+    atomic_compare_exchange_strong(&pending_alert_us, &expected, esp_timer_get_time());
+    xEventGroupSetBits(report_event_group, REPORT_FALL_BIT);
+}
+
+// Called from a network completion callback, wakes the uploader to apply the result
+void report_signal_net_done(void) {
+    xEventGroupSetBits(report_event_group, REPORT_NET_DONE_BIT);
+}
+
+// Block until an urgent or net-done bit is set or the timeout expires.
+// Returns (and clears) every pending bit. Routine data needs no signal, the
+// uploader collects it from telemetry and the event bus on every coalesced flush.
+EventBits_t report_wait(TickType_t timeout) {
+    xEventGroupWaitBits(report_event_group, REPORT_URGENT_BITS | REPORT_NET_DONE_BIT, pdFALSE, pdFALSE, timeout);
+    return xEventGroupClearBits(report_event_group, REPORT_FALL_BIT | REPORT_NET_DONE_BIT);
+}
+
+// Called once the POST carrying the pending alert has completed
+void report_complete_alert(void) {
+    int64_t detected_us = atomic_exchange(&pending_alert_us, 0);
+    if (detected_us == 0) {
+        return;
+    }
+    uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - detected_us);
+
+    portENTER_CRITICAL(&latency_mux);
+    latency.count++;
+    latency.last_us = elapsed_us;
+    latency.total_us += elapsed_us;
+    if (elapsed_us > latency.max_us) {
+        latency.max_us = elapsed_us;
+    }
+    portEXIT_CRITICAL(&latency_mux);
+
+    ESP_LOGI(TAG, "Alert latency %" PRIu32 " ms (max %" PRIu32 " ms over %" PRIu32 " alerts)",
+             elapsed_us / 1000, latency.max_us / 1000, latency.count);
+}
+
+void report_get_latency(report_latency_t *latency_out) {
+    portENTER_CRITICAL(&latency_mux);
+    *latency_out = latency;
+    portEXIT_CRITICAL(&latency_mux);
+}
@@ -0,0 +1,175 @@
+#include "esp_log.h"
+#include "esp_random.h"
+#include "retry.h"
+#include "uptime.h"
+
+static const char *TAG = "retry";
+
+// Between half and all of delay_ms, so devices that lost the same
+// backend do not all come back at the same instant
+static int64_t jittered_us(uint32_t delay_ms) {
+    uint32_t half = delay_ms / 2;
+    uint32_t ms = half + (half ? esp_random() % (half + 1) : 0);
+    return (int64_t)ms * 1000;
+}
+
+static void open_breaker(retry_policy_t *policy, int64_t now) {
+    policy->state = RETRY_OPEN;
+    policy->stats.opens++;
+    policy->next_attempt_us = now + jittered_us(policy->open_ms);
+    ESP_LOGW(TAG, "%s: breaker open for %lu s after %lu failures", policy->name,
+             (unsigned long)(policy->open_ms / 1000), (unsigned long)policy->consecutive_failures);
+}
+
+void retry_init(retry_policy_t *policy, const char *name) {
+    *policy = (retry_policy_t){
+        .name = name,
+        .lock = xSemaphoreCreateMutex(),
+        .state = RETRY_CLOSED,
+        .open_ms = RETRY_OPEN_MS,
+    };
+}
+
+// Ask to make an attempt now. Every true must be followed by retry_end().
+bool retry_begin(retry_policy_t *policy) {
+    int64_t now = uptime_us();
+    bool allowed = false;
+
+    xSemaphoreTake(policy->lock, portMAX_DELAY);
+    switch (policy->state) {
+        case RETRY_CLOSED:
+            allowed = now >= policy->next_attempt_us;
+            break;
+        case RETRY_OPEN:
+            if (now >= policy->next_attempt_us) {
+                // Let one probe through, everything else waits for its result
+                policy->state = RETRY_HALF_OPEN;
+                allowed = true;
+            }
+            break;
+        case RETRY_HALF_OPEN:
+            break;
+    }
+    if (allowed) {
+        policy->stats.attempts++;
+    } else {
+        policy->stats.refused++;
+    }
+    xSemaphoreGive(policy->lock);
+    return allowed;
+}
+
+// Record the outcome of an attempt retry_begin() let through
+void retry_end(retry_policy_t *policy, bool success) {
+    int64_t now = uptime_us();
+
+    xSemaphoreTake(policy->lock, portMAX_DELAY);
+    if (success) {
+        if (policy->state != RETRY_CLOSED) {
+            ESP_LOGI(TAG, "%s: breaker closed", policy->name);
+        }
+        policy->stats.successes++;
+        policy->state = RETRY_CLOSED;
+        policy->consecutive_failures = 0;
+        policy->open_ms = RETRY_OPEN_MS;
+        policy->next_attempt_us = 0;
+    } else {
+        policy->stats.failures++;
+        policy->consecutive_failures++;
+        if (policy->state == RETRY_HALF_OPEN) {
+            // Probe failed, stay away longer this time
+            policy->open_ms = policy->open_ms * 2 > RETRY_OPEN_MAX_MS ? RETRY_OPEN_MAX_MS : policy->open_ms * 2;
+            open_breaker(policy, now);
+        } else if (policy->state == RETRY_CLOSED && policy->consecutive_failures >= RETRY_OPEN_AFTER) {
+            open_breaker(policy, now);
+        } else if (policy->state == RETRY_CLOSED) {
+            uint32_t shift = policy->consecutive_failures - 1;
+            uint32_t delay_ms = shift < 16 ? RETRY_BASE_MS << shift : RETRY_MAX_MS;
+            if (delay_ms > RETRY_MAX_MS) {
+                delay_ms = RETRY_MAX_MS;
+            }
+            policy->next_attempt_us = now + jittered_us(delay_ms);
+        }
+    }
+    xSemaphoreGive(policy->lock);
+}
+
+// Milliseconds until retry_begin() would let an attempt through, 0 if now.
+// While a half-open probe is out this is the open period, its result comes first.
+uint32_t retry_delay_ms(retry_policy_t *policy) {
+    int64_t now = uptime_us();
+    uint32_t delay_ms;
+
+    xSemaphoreTake(policy->lock, portMAX_DELAY);
+    if (policy->state == RETRY_HALF_OPEN) {
+        delay_ms = policy->open_ms;
+    } else if (now >= policy->next_attempt_us) {
+        delay_ms = 0;
+    } else {
+        delay_ms = (policy->next_attempt_us - now + 999) / 1000;
+    }
+    xSemaphoreGive(policy->lock);
+    return delay_ms;
+}
+
+retry_state_t retry_get_state(retry_policy_t *policy) {
+    xSemaphoreTake(policy->lock, portMAX_DELAY);
+    retry_state_t state = policy->state;
+    xSemaphoreGive(policy->lock);
+    return state;
+}
+
+void retry_get_stats(retry_policy_t *policy, retry_stats_t *stats_out) {
+    xSemaphoreTake(policy->lock, portMAX_DELAY);
+    *stats_out = policy->stats;
+    xSemaphoreGive(policy->lock);
+}
+
+const char *retry_state_name(retry_state_t state) {
+    switch (state) {
+        case RETRY_CLOSED:
+            return "closed";
+        case RETRY_OPEN:
+            return "open";
+        case RETRY_HALF_OPEN:
+            return "half-open";
+    }
+    return "?";
+}
+
+// Responses that mean the server is overloaded or down, as opposed to
+// rejecting this particular request
+bool retry_http_status_failed(int status_code) {
+    return status_code == 429 || status_code >= 500;
+}
+
+// A probe is never in flight when saving, so half-open is saved as open
+// and probes again as soon as the restored open period has run out
+void retry_save(retry_policy_t *policy, retry_snapshot_t *snapshot_out) {
+    xSemaphoreTake(policy->lock, portMAX_DELAY);
+    *snapshot_out = (retry_snapshot_t){
+        .state = policy->state == RETRY_HALF_OPEN ? RETRY_OPEN : policy->state,
+        .consecutive_failures = policy->consecutive_failures,
+        .open_ms = policy->open_ms,
+        .next_attempt_us = policy->next_attempt_us,
+    };
+    xSemaphoreGive(policy->lock);
+}
+
+// Continue the backoff and breaker of a snapshot taken before deep sleep.
+// Call after retry_init(); a snapshot that was never saved is ignored.
+void retry_restore(retry_policy_t *policy, const retry_snapshot_t *snapshot) {
+    if (snapshot->open_ms == 0) {
+        return;
+    }
+    xSemaphoreTake(policy->lock, portMAX_DELAY);
+    policy->state = snapshot->state;
+    policy->consecutive_failures = snapshot->consecutive_failures;
+    policy->open_ms = snapshot->open_ms;
+    policy->next_attempt_us = snapshot->next_attempt_us;
+    xSemaphoreGive(policy->lock);
+    if (policy->state != RETRY_CLOSED) {
+        ESP_LOGI(TAG, "%s: breaker %s, %lu ms to the next attempt", policy->name,
+                 retry_state_name(policy->state), (unsigned long)retry_delay_ms(policy));
+    }
+}
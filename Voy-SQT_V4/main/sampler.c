@@ -0,0 +1,139 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sampler.h"
+
+static const char *TAG = "sampler";
+
+typedef struct {
+    const char *name;
+    uint32_t period_us;
+    uint32_t phase_us;
+    esp_timer_handle_t timer;
+    SemaphoreHandle_t ready;    // Given once per deadline
+    int64_t deadline_us;        // Next timer deadline, only touched by the timer
+    int64_t due_us;             // Deadline the task waits for next, only touched by the task
+    int64_t last_wake_us;
+    sampler_stats_t stats;
+} sampler_slot_state_t;
+
+static sampler_slot_state_t slots[SAMPLER_NUM_SLOTS] = {
+    [SAMPLER_IMU] = { .name = "imu", .period_us = SAMPLER_IMU_PERIOD_MS * 1000, .phase_us = SAMPLER_IMU_PHASE_MS * 1000 },
+    [SAMPLER_TEMP_HUM] = { .name = "temp_hum", .period_us = SAMPLER_TEMP_HUM_PERIOD_MS * 1000, .phase_us = SAMPLER_TEMP_HUM_PHASE_MS * 1000 },
+    [SAMPLER_LOG] = { .name = "log", .period_us = SAMPLER_LOG_PERIOD_MS * 1000, .phase_us = SAMPLER_LOG_PHASE_MS * 1000 },
+};
+
+static const uint32_t hist_edges_us[SAMPLER_HIST_BUCKETS - 1] = SAMPLER_HIST_EDGES_US;
+
+// Re-armed against the absolute deadline each time, so callback latency
+// never accumulates into the schedule
+static void sampler_timer_cb(void *arg) {
+    sampler_slot_state_t *slot = (sampler_slot_state_t *)arg;
+    xSemaphoreGive(slot->ready);
+
+    slot->deadline_us += slot->period_us;
+    int64_t delay_us = slot->deadline_us - esp_timer_get_time();
+    esp_timer_start_once(slot->timer, delay_us > 0 ? delay_us : 0);
+}
+
+// Call before the tasks that use sampler_wait() start
+esp_err_t sampler_init(void) {
+    int64_t start_us = esp_timer_get_time();
+
+    for (int i = 0; i < SAMPLER_NUM_SLOTS; i++) {
+        sampler_slot_state_t *slot = &slots[i];
+        // Deadlines that pile up while the task works are counted, not queued forever
+        slot->ready = xSemaphoreCreateCounting(UINT16_MAX, 0);
+        if (slot->ready == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+
+        const esp_timer_create_args_t timer_args = {
+            .callback = sampler_timer_cb,
+            .arg = slot,
+            .name = slot->name,
+        };
+        esp_err_t err = esp_timer_create(&timer_args, &slot->timer);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create %s timer: %s", slot->name, esp_err_to_name(err));
+            return err;
+        }
+
+        slot->deadline_us = start_us + slot->period_us + slot->phase_us;
+        slot->due_us = slot->deadline_us;
+        slot->last_wake_us = 0;
+        esp_timer_start_once(slot->timer, slot->deadline_us - start_us);
+    }
+    return ESP_OK;
+}
+
+// Block until the slot's next deadline and record how close to it we woke.
+// Call once per cycle, after the cycle's work.
+void sampler_wait(sampler_slot_t slot_id) {
+    sampler_slot_state_t *slot = &slots[slot_id];
+    sampler_stats_t *stats = &slot->stats;
+
+    int64_t now = esp_timer_get_time();
+    if (slot->last_wake_us) {
+        uint32_t work_us = (uint32_t)(now - slot->last_wake_us);
+        if (work_us > stats->max_work_us) {
+            stats->max_work_us = work_us;
+        }
+        if (work_us > slot->period_us) {
+            stats->overruns++;
+        }
+    }
+
+    xSemaphoreTake(slot->ready, portMAX_DELAY);
+    now = esp_timer_get_time();
+
+    // More deadlines passed while working, skip to the latest one
+    uint32_t missed = 0;
+    while (xSemaphoreTake(slot->ready, 0) == pdTRUE) {
+        missed++;
+    }
+    stats->missed += missed;
+    slot->due_us += (int64_t)slot->period_us * missed;
+
+    uint32_t latency_us = now > slot->due_us ? (uint32_t)(now - slot->due_us) : 0;
+    if (latency_us > stats->max_latency_us) {
+        stats->max_latency_us = latency_us;
+    }
+
+    if (slot->last_wake_us) {
+        int64_t expected_us = (int64_t)slot->period_us * (missed + 1);
+        int64_t error = (now - slot->last_wake_us) - expected_us;
+        uint32_t error_us = error < 0 ? -error : error;
+        if (error_us > stats->max_error_us) {
+            stats->max_error_us = error_us;
+        }
+        int bucket = 0;
+        while (bucket < SAMPLER_HIST_BUCKETS - 1 && error_us >= hist_edges_us[bucket]) {
+            bucket++;
+        }
+        stats->hist[bucket]++;
+    }
+
+    stats->wakes++;
+    slot->due_us += slot->period_us;
+    slot->last_wake_us = now;
+}
+
+void sampler_get_stats(sampler_slot_t slot_id, sampler_stats_t *stats_out) {
+    *stats_out = slots[slot_id].stats;
+}
+
+void sampler_log_report(void) {
+    for (int i = 0; i < SAMPLER_NUM_SLOTS; i++) {
+        const sampler_stats_t *s = &slots[i].stats;
+        ESP_LOGI(TAG, "%s: %lu wakes, %lu missed, %lu overruns, max latency %lu us, max error %lu us, max work %lu us",
+                 slots[i].name, (unsigned long)s->wakes, (unsigned long)s->missed, (unsigned long)s->overruns,
+                 (unsigned long)s->max_latency_us, (unsigned long)s->max_error_us, (unsigned long)s->max_work_us);
+        ESP_LOGI(TAG, "%s error <0.1/0.5/1/2/5/10/20/>=20 ms: %lu %lu %lu %lu %lu %lu %lu %lu", slots[i].name,
+                 (unsigned long)s->hist[0], (unsigned long)s->hist[1], (unsigned long)s->hist[2],
+                 (unsigned long)s->hist[3], (unsigned long)s->hist[4], (unsigned long)s->hist[5],
+                 (unsigned long)s->hist[6], (unsigned long)s->hist[7]);
+    }
+}
@@ -1,25 +1,35 @@
 #include "io_pins.h"
 #include "sensors.h"
-#include <stdio.h>
+#include "esp_log.h"
 #include "dht.h"
-#include "esp_adc/adc_oneshot.h"
-#include "driver/adc.h"
+#include "imu_adc.h"
+#include "power.h"
 
-imu_data_t read_imu() {
-    imu_data_t data;
+static const char *TAG = "sensors";
 
-    data.x = adc1_get_raw(IMU_X_PIN);
-    data.y = adc1_get_raw(IMU_Y_PIN);
-    data.z = adc1_get_raw(IMU_Z_PIN);
+// Most recent sample from the continuous ADC engine
+imu_data_t read_imu() {
+    return imu_adc_get_latest();
+}
 
-    return data;
+// Capture the DHT pulse train with the RMT peripheral instead of busy-waiting.
+// read_temp_hum_sensor() falls back to bit-banging if this fails.
+void temp_hum_sensor_init() {
+    dht_rmt_handle_t dht_rmt;
+    if (dht_rmt_new(TEMP_HUM_PIN, &dht_rmt) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to create DHT RMT backend, using GPIO polling");
+    }
 }
 
 temp_hum_data_t read_temp_hum_sensor() {
     temp_hum_data_t data;
 
-    if (dht_read_float_data(DHT_TYPE_DHT11, TEMP_HUM_PIN, 
-                            &data.humidity, &data.temperature) == ESP_OK) {
+    // No light sleep in the middle of the pulse train
+    power_lock_acquire(POWER_LOCK_SENSOR);
+    esp_err_t err = dht_read_float_data(DHT_TYPE_DHT11, TEMP_HUM_PIN, 
+                                        &data.humidity, &data.temperature);
+    power_lock_release(POWER_LOCK_SENSOR);
+    if (err == ESP_OK) {
         return data;
     }
     data.temperature = 25.0;
@@ -0,0 +1,19 @@
+#include <stdatomic.h>
+#include "telemetry.h"
+
+// Lock-free so a writer is never blocked by a reader and an increment is never lost
+static _Atomic uint32_t counters[TELEMETRY_NUM_COUNTERS];
+
+void telemetry_increment(telemetry_counter_t counter) {
+    atomic_fetch_add_explicit(&counters[counter], 1, memory_order_relaxed);
+}
+
+// Read without resetting, for display
+uint32_t telemetry_peek(telemetry_counter_t counter) {
+    return atomic_load_explicit(&counters[counter], memory_order_relaxed);
+}
+
+// Read and reset in one step, for reporting
+uint32_t telemetry_take(telemetry_counter_t counter) {
+    return atomic_exchange_explicit(&counters[counter], 0, memory_order_relaxed);
+}
@@ -0,0 +1,472 @@
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "tlog.h"
+#include "cbor.h"
+#include "uptime.h"
+
+static const char *TAG = "tlog";
+
+_Static_assert(sizeof(tlog_record_t) == TLOG_RECORD_SIZE, "tlog record must stay fixed size");
+
+#define SEQ_FREE    0xFFFFFFFF
+#define NOT_SENT    0xFFFFFFFF
+
+// Records read per flash access while scanning
+#define SCAN_CHUNK  16
+
+// The log is a ring of record slots. head is the next slot to write, tail the
+// oldest slot that may still be unsent. Sectors are erased just before head
+// enters them, so every sector is erased once per lap of the ring.
+static const esp_partition_t *partition = NULL;
+static uint32_t capacity = 0;
+static uint32_t head = 0;
+static uint32_t tail = 0;
+static uint32_t next_seq = 0;
+static uint16_t boot = 0;
+
+// Slots covered by the last encode, acknowledged on commit
+static uint32_t encoded_slots[TLOG_DRAIN_BATCH];
+static uint32_t encoded_count = 0;
+static uint32_t encoded_end = 0;
+static uint32_t encoded_falls = 0;
+
+static int64_t next_drain_us = 0;
+static tlog_stats_t stats;
+
+static uint32_t record_crc(const tlog_record_t *rec) {
+    return esp_rom_crc32_le(0, (const uint8_t *)rec, offsetof(tlog_record_t, crc));
+}
+
+static bool record_valid(const tlog_record_t *rec) {
+    return rec->seq != SEQ_FREE && rec->crc == record_crc(rec);
+}
+
+static bool record_blank(const tlog_record_t *rec) {
+    const uint8_t *p = (const uint8_t *)rec;
+    for (size_t i = 0; i < sizeof(*rec); i++) {
+        if (p[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static esp_err_t read_record(uint32_t slot, tlog_record_t *rec) {
+    return esp_partition_read(partition, slot * TLOG_RECORD_SIZE, rec, sizeof(*rec));
+}
+
+static uint16_t saturate_u16(int v) {
+    return v < 0 ? 0 : v > UINT16_MAX ? UINT16_MAX : v;
+}
+
+// Erase the sector head is about to enter. Unsent records in it are lost.
+static esp_err_t erase_sector_at(uint32_t slot) {
+    uint32_t sector = slot / TLOG_RECORDS_PER_SECTOR;
+    uint32_t first = sector * TLOG_RECORDS_PER_SECTOR;
+    uint32_t last = first + TLOG_RECORDS_PER_SECTOR;
+
+    if (stats.pending > 0 && tail >= first && tail < last) {
+        tlog_record_t rec;
+        uint32_t lost = 0;
+        for (uint32_t i = tail; i < last; i++) {
+            if (read_record(i, &rec) == ESP_OK && record_valid(&rec) && rec.sent == NOT_SENT) {
+                lost++;
+            }
+        }
+        stats.dropped += lost;
+        stats.pending -= lost;
+        tail = last % capacity;
+        ESP_LOGW(TAG, "Log full, dropped %lu unsent records", (unsigned long)lost);
+
+        // An upload of the last encode may still be in flight. Its records in
+        // this sector are gone and already counted as dropped, so commit skips them.
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < encoded_count; i++) {
+            if (encoded_slots[i] < first || encoded_slots[i] >= last) {
+                encoded_slots[kept++] = encoded_slots[i];
+            }
+        }
+        encoded_count = kept;
+        if (encoded_end >= first && encoded_end < last) {
+            encoded_end = tail;
+        }
+    }
+
+    return esp_partition_erase_range(partition, sector * TLOG_SECTOR_SIZE, TLOG_SECTOR_SIZE);
+}
+
+// Rebuild head, tail and the pending count from the records on flash
+esp_err_t tlog_init(void) {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, TLOG_PARTITION_SUBTYPE, TLOG_PARTITION_LABEL);
+    if (partition == NULL) {
+        ESP_LOGE(TAG, "No '%s' partition, store-and-forward disabled", TLOG_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    capacity = (partition->size / TLOG_SECTOR_SIZE) * TLOG_RECORDS_PER_SECTOR;
+    memset(&stats, 0, sizeof(stats));
+    stats.capacity = capacity;
+
+    bool have_any = false;
+    bool have_unsent = false;
+    uint32_t max_seq = 0;
+    uint32_t max_slot = 0;
+    uint32_t min_unsent_seq = 0;
+    uint16_t max_boot = 0;
+
+    tlog_record_t chunk[SCAN_CHUNK];
+    for (uint32_t base = 0; base < capacity; base += SCAN_CHUNK) {
+        esp_err_t err = esp_partition_read(partition, base * TLOG_RECORD_SIZE, chunk, sizeof(chunk));
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Read failed at slot %lu: %s", (unsigned long)base, esp_err_to_name(err));
+            partition = NULL;
+            return err;
+        }
+        for (uint32_t i = 0; i < SCAN_CHUNK; i++) {
+            const tlog_record_t *rec = &chunk[i];
+            if (rec->seq == SEQ_FREE) {
+                continue;
+            }
+            if (!record_valid(rec)) {
+                stats.corrupt++;
+                continue;
+            }
+            if (!have_any || rec->seq > max_seq) {
+                have_any = true;
+                max_seq = rec->seq;
+                max_slot = base + i;
+                max_boot = rec->boot;
+            }
+            if (rec->sent == NOT_SENT) {
+                stats.pending++;
+                if (!have_unsent || rec->seq < min_unsent_seq) {
+                    have_unsent = true;
+                    min_unsent_seq = rec->seq;
+                    tail = base + i;
+                }
+            }
+        }
+    }
+
+    if (have_any) {
+        head = (max_slot + 1) % capacity;
+        next_seq = max_seq + 1;
+        boot = max_boot + 1;
+    }
+    if (!have_unsent) {
+        tail = head;
+    }
+
+    ESP_LOGI(TAG, "Boot %u, %lu of %lu records pending, %lu corrupt", boot,
+             (unsigned long)stats.pending, (unsigned long)capacity, (unsigned long)stats.corrupt);
+    return ESP_OK;
+}
+
+// Pick up the ring where tlog_save_cursor() left it before deep sleep,
+// falling back to a full scan if the cursor does not match the partition
+esp_err_t tlog_resume(const tlog_cursor_t *cursor) {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, TLOG_PARTITION_SUBTYPE, TLOG_PARTITION_LABEL);
+    if (partition == NULL) {
+        ESP_LOGE(TAG, "No '%s' partition, store-and-forward disabled", TLOG_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint32_t slots = (partition->size / TLOG_SECTOR_SIZE) * TLOG_RECORDS_PER_SECTOR;
+    if (cursor->capacity != slots || cursor->head >= slots || cursor->tail >= slots || cursor->pending > slots) {
+        return tlog_init();
+    }
+
+    capacity = slots;
+    head = cursor->head;
+    tail = cursor->tail;
+    next_seq = cursor->next_seq;
+    // Same boot: uptime_us() carries on across deep sleep, so records from
+    // earlier wakes stay on this boot's timeline
+    boot = cursor->boot;
+    memset(&stats, 0, sizeof(stats));
+    stats.capacity = capacity;
+    stats.pending = cursor->pending;
+    return ESP_OK;
+}
+
+void tlog_save_cursor(tlog_cursor_t *cursor_out) {
+    *cursor_out = (tlog_cursor_t){
+        .capacity = partition ? capacity : 0,
+        .head = head,
+        .tail = tail,
+        .next_seq = next_seq,
+        .pending = stats.pending,
+        .boot = boot,
+    };
+}
+
+// Only called from the uploader task
+esp_err_t tlog_append(const batch_record_t *record) {
+    if (partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    tlog_record_t rec;
+    esp_err_t err;
+
+    // Entering a new sector, or the slot was left dirty by a torn write
+    if (head % TLOG_RECORDS_PER_SECTOR != 0) {
+        err = read_record(head, &rec);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (!record_blank(&rec)) {
+            head = (head / TLOG_RECORDS_PER_SECTOR + 1) * TLOG_RECORDS_PER_SECTOR % capacity;
+        }
+    }
+    if (head % TLOG_RECORDS_PER_SECTOR == 0) {
+        err = erase_sector_at(head);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Erase failed: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    memset(&rec, 0xFF, sizeof(rec));
+    rec.seq = next_seq;
+    rec.uptime_ms = (uint32_t)(record->timestamp_us / 1000);
+    rec.boot = boot;
+    rec.flags = record->has_location ? TLOG_FLAG_LOCATION : 0;
+    rec.fall_events = record->fall_events > UINT8_MAX ? UINT8_MAX : record->fall_events;
+    rec.overtemp_events = saturate_u16(record->overtemp_events);
+    rec.overhum_events = saturate_u16(record->overhum_events);
+    rec.longitude_e6 = (int32_t)(record->longitude * 1e6);
+    rec.latitude_e6 = (int32_t)(record->latitude * 1e6);
+    rec.crc = record_crc(&rec);
+
+    err = esp_partition_write(partition, head * TLOG_RECORD_SIZE, &rec, sizeof(rec));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Write failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if (stats.pending == 0) {
+        tail = head;
+    }
+    head = (head + 1) % capacity;
+    next_seq++;
+    stats.pending++;
+    stats.appended++;
+    return ESP_OK;
+}
+
+uint32_t tlog_pending(void) {
+    return stats.pending;
+}
+
+// Backlog waiting and the drain rate cap allows another request
+bool tlog_should_drain(void) {
+    return stats.pending > 0 && esp_timer_get_time() >= next_drain_us;
+}
+
+// Find the next unsent record at or after *slot, stopping at head
+static bool find_pending(uint32_t *slot, uint32_t *seen, tlog_record_t *rec) {
+    while (*slot != head && *seen < capacity) {
+        if (read_record(*slot, rec) != ESP_OK) {
+            return false;
+        }
+        if (record_valid(rec) && rec->sent == NOT_SENT) {
+            return true;
+        }
+        *slot = (*slot + 1) % capacity;
+        (*seen)++;
+    }
+    return false;
+}
+
+static void mark_encoded(uint32_t *slot, uint32_t *seen, const tlog_record_t *rec) {
+    encoded_slots[encoded_count++] = *slot;
+    encoded_falls += rec->fall_events;
+    *slot = (*slot + 1) % capacity;
+    (*seen)++;
+}
+
+// Encode up to TLOG_DRAIN_BATCH unsent records, oldest first. Records carry
+// the boot and uptime they were written at; "now" gives the current pair.
+size_t tlog_encode_json(char *buf, size_t buf_len) {
+    size_t len = snprintf(buf, buf_len, "{\"uid\":%d,\"now\":{\"boot\":%u,\"t\":%lu},\"events\":[",
+                          2808, boot, (unsigned long)(uptime_us() / 1000));
+    encoded_count = 0;
+    encoded_falls = 0;
+
+    uint32_t slot = tail;
+    uint32_t seen = 0;
+    tlog_record_t rec;
+    while (stats.pending > 0 && encoded_count < TLOG_DRAIN_BATCH && find_pending(&slot, &seen, &rec)) {
+        char item[128];
+        int n;
+        if (rec.flags & TLOG_FLAG_LOCATION) {
+            n = snprintf(item, sizeof(item),
+                         "%s{\"boot\":%u,\"t\":%lu,\"fall\":%u,\"temp\":%u,\"hum\":%u,\"long\":%.6f,\"lat\":%.6f}",
+                         encoded_count ? "," : "", rec.boot, (unsigned long)rec.uptime_ms, rec.fall_events,
+                         rec.overtemp_events, rec.overhum_events, rec.longitude_e6 / 1e6, rec.latitude_e6 / 1e6);
+        } else {
+            n = snprintf(item, sizeof(item), "%s{\"boot\":%u,\"t\":%lu,\"fall\":%u,\"temp\":%u,\"hum\":%u}",
+                         encoded_count ? "," : "", rec.boot, (unsigned long)rec.uptime_ms, rec.fall_events,
+                         rec.overtemp_events, rec.overhum_events);
+        }
+        // Keep room for the closing "]}"
+        if (n < 0 || len + n + 3 > buf_len) {
+            break;
+        }
+        memcpy(buf + len, item, n);
+        len += n;
+        mark_encoded(&slot, &seen, &rec);
+    }
+    encoded_end = slot;
+
+    memcpy(buf + len, "]}", 3);
+    return len + 2;
+}
+
+// Same records and keys as tlog_encode_json, in CBOR
+size_t tlog_encode_cbor(uint8_t *buf, size_t buf_len) {
+    cbor_writer_t w;
+    encoded_count = 0;
+    encoded_falls = 0;
+
+    // Hold back one byte for the break that closes the array
+    cbor_writer_init(&w, buf, buf_len - 1);
+    cbor_start_map(&w, 3);
+    cbor_put_text(&w, "uid");
+    cbor_put_uint(&w, 2808);
+    cbor_put_text(&w, "now");
+    cbor_start_map(&w, 2);
+    cbor_put_text(&w, "boot");
+    cbor_put_uint(&w, boot);
+    cbor_put_text(&w, "t");
+    cbor_put_uint(&w, (uint64_t)(uptime_us() / 1000));
+    cbor_put_text(&w, "events");
+    cbor_start_indefinite_array(&w);
+    if (w.overflow) {
+        encoded_end = tail;
+        return 0;
+    }
+
+    uint32_t slot = tail;
+    uint32_t seen = 0;
+    tlog_record_t rec;
+    while (stats.pending > 0 && encoded_count < TLOG_DRAIN_BATCH && find_pending(&slot, &seen, &rec)) {
+        size_t mark = w.len;
+        bool has_location = rec.flags & TLOG_FLAG_LOCATION;
+        cbor_start_map(&w, has_location ? 7 : 5);
+        cbor_put_text(&w, "boot");
+        cbor_put_uint(&w, rec.boot);
+        cbor_put_text(&w, "t");
+        cbor_put_uint(&w, rec.uptime_ms);
+        cbor_put_text(&w, "fall");
+        cbor_put_uint(&w, rec.fall_events);
+        cbor_put_text(&w, "temp");
+        cbor_put_uint(&w, rec.overtemp_events);
+        cbor_put_text(&w, "hum");
+        cbor_put_uint(&w, rec.overhum_events);
+        if (has_location) {
+            cbor_put_text(&w, "long");
+            cbor_put_float(&w, rec.longitude_e6 / 1e6f);
+            cbor_put_text(&w, "lat");
+            cbor_put_float(&w, rec.latitude_e6 / 1e6f);
+        }
+        if (w.overflow) {
+            cbor_rollback(&w, mark);
+            break;
+        }
+        mark_encoded(&slot, &seen, &rec);
+    }
+    encoded_end = slot;
+
+    w.cap = buf_len;
+    cbor_end_indefinite(&w);
+    return w.len;
+}
+
+// Oldest unsent record alone, in the schema of the single-record endpoint.
+// The boot and uptime it was written at are lost on the way.
+size_t tlog_encode_legacy(char *buf, size_t buf_len) {
+    encoded_count = 0;
+    encoded_falls = 0;
+
+    uint32_t slot = tail;
+    uint32_t seen = 0;
+    tlog_record_t rec;
+    size_t len = 0;
+    if (stats.pending > 0 && find_pending(&slot, &seen, &rec)) {
+        bool has_location = rec.flags & TLOG_FLAG_LOCATION;
+        int n = snprintf(buf, buf_len, "{\"uid\":%d, \"long\":%f, \"lat\":%f, \"fall\":%u, \"temp\":%u, \"hum\":%u}",
+                         2808, has_location ? rec.longitude_e6 / 1e6 : 0.0, has_location ? rec.latitude_e6 / 1e6 : 0.0,
+                         rec.fall_events, rec.overtemp_events, rec.overhum_events);
+        if (n > 0 && (size_t)n < buf_len) {
+            len = n;
+            mark_encoded(&slot, &seen, &rec);
+        }
+    }
+    encoded_end = slot;
+    return len;
+}
+
+// Encode in BATCH_FORMAT, send with batch_content_type()
+size_t tlog_encode(uint8_t *buf, size_t buf_len) {
+#if BATCH_FORMAT == BATCH_FORMAT_CBOR
+    return tlog_encode_cbor(buf, buf_len);
+#elif BATCH_FORMAT == BATCH_FORMAT_LEGACY
+    return tlog_encode_legacy((char *)buf, buf_len);
+#else
+    return tlog_encode_json((char *)buf, buf_len);
+#endif
+}
+
+// Mark the records of the last encoded batch sent in place, the drain moves past them
+static void mark_encoded_sent(void) {
+    static const uint32_t sent = 0;
+    for (uint32_t i = 0; i < encoded_count; i++) {
+        uint32_t offset = encoded_slots[i] * TLOG_RECORD_SIZE + offsetof(tlog_record_t, sent);
+        esp_err_t err = esp_partition_write(partition, offset, &sent, sizeof(sent));
+        if (err != ESP_OK) {
+            // Still counted as sent for this boot; it may be uploaded again after a reboot
+            ESP_LOGW(TAG, "Failed to mark slot %lu sent: %s", (unsigned long)encoded_slots[i], esp_err_to_name(err));
+        }
+    }
+
+    stats.pending -= encoded_count;
+    tail = stats.pending > 0 ? encoded_end : head;
+    encoded_count = 0;
+    next_drain_us = esp_timer_get_time() + (int64_t)TLOG_DRAIN_INTERVAL_MS * 1000;
+}
+
+// The last encoded batch was delivered
+void tlog_commit(void) {
+    stats.drained += encoded_count;
+    mark_encoded_sent();
+}
+
+// The backend answered but refused the last encoded batch (a 4xx other than
+// 429). Sending it again would get the same answer, so drop it like a
+// delivered one instead of holding up the records behind it.
+void tlog_reject(void) {
+    ESP_LOGW(TAG, "Backend rejected %lu logged records, dropping them", (unsigned long)encoded_count);
+    stats.rejected += encoded_count;
+    mark_encoded_sent();
+}
+
+// The last encoded batch was not delivered. Backoff after failures is up
+// to the backend retry policy (retry.h), this only keeps the drain pacing.
+void tlog_abort(void) {
+    encoded_count = 0;
+    next_drain_us = esp_timer_get_time() + (int64_t)TLOG_DRAIN_INTERVAL_MS * 1000;
+}
+
+// Fall events among the records of the last encoded batch
+uint32_t tlog_encoded_falls(void) {
+    return encoded_falls;
+}
+
+void tlog_get_stats(tlog_stats_t *stats_out) {
+    *stats_out = stats;
+}
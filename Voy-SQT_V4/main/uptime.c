@@ -0,0 +1,14 @@
+#include "esp_timer.h"
+#include "uptime.h"
+
+// Time already elapsed when esp_timer started counting from zero
+static int64_t base = 0;
+
+int64_t uptime_us(void) {
+    return base + esp_timer_get_time();
+}
+
+// Set once at startup, before any record is stamped
+void uptime_set_base(int64_t base_us) {
+    base = base_us;
+}
@@ -2,9 +2,13 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"  // Added for event groups
 #include <stdio.h>
+#include <string.h>
 #include "esp_log.h"
 #include "esp_wifi.h"
 #include "esp_mac.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "power.h"
 
 static const char *TAG = "main";
 
@@ -13,33 +17,192 @@ static const char *TAG = "main";
 // Define the WiFi event group as a global variable
 EventGroupHandle_t wifi_event_group = NULL;
 
-static int retry_count = 0;
+ESP_EVENT_DEFINE_BASE(WIFI_CM_EVENT);
+
+// Last AP we got an IP from, persisted in NVS. The IP lease itself is kept
+// by lwIP (CONFIG_LWIP_DHCP_RESTORE_LAST_IP) and requested back directly.
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t channel;
+} wifi_last_ap_t;
+
+static wifi_last_ap_t last_ap;
+static bool have_last_ap = false;
+
+// Connection manager state, only touched from the default event loop task
+static bool fast_attempt = false;
+static uint32_t backoff_ms = WIFI_BACKOFF_MIN_MS;
+static esp_timer_handle_t reconnect_timer = NULL;
+static int64_t init_us = 0;
+static int64_t disconnected_us = 0;
+static bool ever_connected = false;
+
+// Written from the event loop, read by wifi_get_stats() from any task
+static portMUX_TYPE stats_mux = portMUX_INITIALIZER_UNLOCKED;
+static wifi_stats_t stats;
+
+static void load_last_ap(void) {
+    nvs_handle_t handle;
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
+    size_t len = sizeof(last_ap);
+    have_last_ap = nvs_get_blob(handle, "last_ap", &last_ap, &len) == ESP_OK && len == sizeof(last_ap);
+    nvs_close(handle);
+}
+
+static void save_last_ap(const wifi_last_ap_t *ap) {
+    // Skip the flash write when nothing changed, the usual case
+    if (have_last_ap && memcmp(ap, &last_ap, sizeof(*ap)) == 0) {
+        return;
+    }
+    last_ap = *ap;
+    have_last_ap = true;
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, "last_ap", ap, sizeof(*ap));
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to save last AP: %s", esp_err_to_name(err));
+    }
+}
+
+// Start one connect attempt. The first after a disconnect (or at boot) goes
+// straight to the cached AP on its channel; after that, full scans.
+static void connect_now(void) {
+    wifi_config_t wifi_config = {
+        .sta = {
+            .ssid = WIFI_SSID,
+            .password = WIFI_PASS,
+            .threshold.authmode = WIFI_AUTH_WPA2_PSK,
+            .listen_interval = POWER_WIFI_LISTEN_INTERVAL,
+        },
+    };
+
+    if (fast_attempt) {
+        memcpy(wifi_config.sta.bssid, last_ap.bssid, sizeof(last_ap.bssid));
+        wifi_config.sta.bssid_set = true;
+        wifi_config.sta.channel = last_ap.channel;
+        wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+        ESP_LOGI(TAG, "Fast reconnect to " MACSTR " on channel %u", MAC2STR(last_ap.bssid), last_ap.channel);
+    } else {
+        wifi_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+        wifi_config.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+        portENTER_CRITICAL(&stats_mux);
+        stats.full_scans++;
+        portEXIT_CRITICAL(&stats_mux);
+    }
+
+    esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+    esp_err_t err = esp_wifi_connect();
+    if (err != ESP_OK) {
+        // Usually a WiFi scan for geolocation in progress, try again shortly
+        ESP_LOGW(TAG, "Connect failed: %s", esp_err_to_name(err));
+        esp_timer_start_once(reconnect_timer, (uint64_t)WIFI_BACKOFF_MIN_MS * 1000);
+    }
+}
+
+// Runs on the esp_timer task, hand the attempt over to the event loop
+static void reconnect_timer_cb(void *arg) {
+    esp_err_t err = esp_event_post(WIFI_CM_EVENT, WIFI_CM_EVENT_RECONNECT, NULL, 0, 0);
+    if (err != ESP_OK) {
+        // Event queue full, try again shortly
+        ESP_LOGW(TAG, "Failed to post reconnect: %s", esp_err_to_name(err));
+        esp_timer_start_once(reconnect_timer, (uint64_t)WIFI_BACKOFF_MIN_MS * 1000);
+    }
+}
 
 static void wifi_event_handler(void* arg, esp_event_base_t event_base,
         int32_t event_id, void* event_data) {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        esp_wifi_connect();
+        fast_attempt = have_last_ap;
+        connect_now();
     } 
+    else if (event_base == WIFI_CM_EVENT && event_id == WIFI_CM_EVENT_RECONNECT) {
+        connect_now();
+    }
     else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        if (retry_count < MAX_WIFI_RETRY) {
-            esp_wifi_connect();
-            retry_count++;
-            ESP_LOGI(TAG, "Retrying connection to AP...");
-        } 
+        wifi_event_sta_disconnected_t *event = (wifi_event_sta_disconnected_t *)event_data;
+        EventBits_t bits = xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
+
+        if (bits & WIFI_CONNECTED_BIT) {
+            // Lost an established link, start timing the reconnect
+            ESP_LOGW(TAG, "Disconnected from AP, reason %d", event->reason);
+            portENTER_CRITICAL(&stats_mux);
+            stats.disconnects++;
+            portEXIT_CRITICAL(&stats_mux);
+            disconnected_us = esp_timer_get_time();
+            backoff_ms = WIFI_BACKOFF_MIN_MS;
+            fast_attempt = have_last_ap;
+            connect_now();
+        }
+        else if (fast_attempt) {
+            // Cached AP not there (or moved channel), scan for any AP right away
+            ESP_LOGI(TAG, "Fast reconnect failed, reason %d, scanning all channels", event->reason);
+            fast_attempt = false;
+            connect_now();
+        }
         else {
-            ESP_LOGE(TAG, "Failed to connect to AP");
+            ESP_LOGI(TAG, "Retrying connection to AP in %lu ms...", (unsigned long)backoff_ms);
+            esp_timer_start_once(reconnect_timer, (uint64_t)backoff_ms * 1000);
+            backoff_ms = backoff_ms * 2 > WIFI_BACKOFF_MAX_MS ? WIFI_BACKOFF_MAX_MS : backoff_ms * 2;
         }
     } 
     else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
         ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
-        retry_count = 0;
+
+        int64_t now = esp_timer_get_time();
+        bool cold_boot = !ever_connected;
+        uint32_t ms = (now - (cold_boot ? init_us : disconnected_us)) / 1000;
+        ever_connected = true;
+
+        portENTER_CRITICAL(&stats_mux);
+        if (cold_boot) {
+            stats.cold_boot_ms = ms;
+        } else {
+            stats.reconnects++;
+            stats.last_reconnect_ms = ms;
+            stats.total_reconnect_ms += ms;
+            if (ms > stats.max_reconnect_ms) {
+                stats.max_reconnect_ms = ms;
+            }
+        }
+        if (fast_attempt) {
+            stats.fast_connects++;
+        }
+        portEXIT_CRITICAL(&stats_mux);
+
+        if (cold_boot) {
+            ESP_LOGI(TAG, "Cold boot to IP in %lu ms", (unsigned long)ms);
+        } else {
+            ESP_LOGI(TAG, "Reconnected to IP in %lu ms", (unsigned long)ms);
+        }
+        fast_attempt = false;
+        backoff_ms = WIFI_BACKOFF_MIN_MS;
+
+        wifi_ap_record_t ap;
+        if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK) {
+            wifi_last_ap_t good = { .channel = ap.primary };
+            memcpy(good.bssid, ap.bssid, sizeof(good.bssid));
+            save_last_ap(&good);
+        }
+
         // Signal that WiFi is connected
         xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
     }
 }
 
 void wifi_init_sta(void) {
+    init_us = esp_timer_get_time();
+    load_last_ap();
+
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
@@ -49,6 +212,12 @@ void wifi_init_sta(void) {
         ESP_LOGE(TAG, "Failed to create wifi_event_group");
     }
 
+    const esp_timer_create_args_t timer_args = {
+        .callback = reconnect_timer_cb,
+        .name = "wifi_reconnect",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &reconnect_timer));
+
     esp_netif_t *netif = esp_netif_create_default_wifi_sta();
     esp_netif_set_hostname(netif, WIFI_HOSTNAME);
 
@@ -65,16 +234,22 @@ void wifi_init_sta(void) {
                                                         &wifi_event_handler,
                                                         NULL,
                                                         NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_CM_EVENT,
+                                                        WIFI_CM_EVENT_RECONNECT,
+                                                        &wifi_event_handler,
+                                                        NULL,
+                                                        NULL));
 
-    wifi_config_t wifi_config = {
-        .sta = {
-            .ssid = WIFI_SSID,
-            .password = WIFI_PASS,
-            .threshold.authmode = WIFI_AUTH_WPA2_PSK,
-        },
-    };
-
+    // The STA config is set per attempt by connect_now()
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
     ESP_ERROR_CHECK(esp_wifi_start());
+
+    // Radio off between beacons, waking every POWER_WIFI_LISTEN_INTERVAL of them
+    esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+}
+
+void wifi_get_stats(wifi_stats_t *stats_out) {
+    portENTER_CRITICAL(&stats_mux);
+    *stats_out = stats;
+    portEXIT_CRITICAL(&stats_mux);
 }
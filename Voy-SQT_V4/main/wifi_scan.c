@@ -0,0 +1,112 @@
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "wifi_scan.h"
+
+static const char *TAG = "wifi_scan";
+
+// Only used from the scanning task
+static wifi_ap_record_t records[WIFI_SCAN_MAX_RECORDS];
+static uint16_t learned = 0;
+static uint32_t scans_since_full = WIFI_SCAN_FULL_EVERY;
+static wifi_scan_stats_t stats;
+
+// Keep best[] sorted strongest first, at most one entry per BSSID
+static size_t insert_strongest(wifi_ap_record_t *best, size_t count, size_t max_aps, const wifi_ap_record_t *rec) {
+    for (size_t i = 0; i < count; i++) {
+        if (memcmp(best[i].bssid, rec->bssid, sizeof(rec->bssid)) == 0) {
+            if (rec->rssi <= best[i].rssi) {
+                return count;
+            }
+            // Seen again stronger (another channel), drop the old entry first
+            memmove(&best[i], &best[i + 1], (count - i - 1) * sizeof(*best));
+            count--;
+            break;
+        }
+    }
+    if (count == max_aps && rec->rssi <= best[count - 1].rssi) {
+        return count;
+    }
+
+    size_t i = count < max_aps ? count : max_aps - 1;
+    while (i > 0 && best[i - 1].rssi < rec->rssi) {
+        best[i] = best[i - 1];
+        i--;
+    }
+    best[i] = *rec;
+    return count < max_aps ? count + 1 : count;
+}
+
+// Blocking scan. Fills best with up to max_aps distinct APs, strongest first.
+size_t wifi_scan_strongest(wifi_ap_record_t *best, size_t max_aps) {
+    if (max_aps == 0) {
+        return 0;
+    }
+    bool full = learned == 0 || scans_since_full >= WIFI_SCAN_FULL_EVERY;
+
+    wifi_scan_config_t scan_config = {
+        .show_hidden = true,
+#if WIFI_SCAN_PASSIVE
+        .scan_type = WIFI_SCAN_TYPE_PASSIVE,
+        .scan_time.passive = WIFI_SCAN_PASSIVE_MS,
+#else
+        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
+        .scan_time.active = { .min = WIFI_SCAN_ACTIVE_MIN_MS, .max = WIFI_SCAN_ACTIVE_MAX_MS },
+#endif
+        .home_chan_dwell_time = WIFI_SCAN_HOME_DWELL_MS,
+    };
+    if (!full) {
+        scan_config.channel_bitmap.ghz_2_channels = learned;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t err = esp_wifi_scan_start(&scan_config, true);
+    uint32_t ms = (esp_timer_get_time() - start_us) / 1000;
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error starting WiFi scan: %s", esp_err_to_name(err));
+        return 0;
+    }
+
+    uint16_t num = WIFI_SCAN_MAX_RECORDS;
+    err = esp_wifi_scan_get_ap_records(&num, records);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error getting AP records: %s", esp_err_to_name(err));
+        return 0;
+    }
+
+    size_t count = 0;
+    uint16_t seen_channels = 0;
+    for (uint16_t i = 0; i < num; i++) {
+        count = insert_strongest(best, count, max_aps, &records[i]);
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (best[i].primary >= 1 && best[i].primary <= WIFI_SCAN_NUM_CHANNELS) {
+            seen_channels |= 1u << best[i].primary;
+        }
+    }
+
+    // Learn from full sweeps, widen the next scan when the short list came back thin
+    if (full) {
+        learned = seen_channels;
+        scans_since_full = 0;
+        stats.full_scans++;
+    } else {
+        scans_since_full = count < max_aps ? WIFI_SCAN_FULL_EVERY : scans_since_full + 1;
+    }
+
+    stats.scans++;
+    stats.last_ms = ms;
+    stats.total_ms += ms;
+    if (ms > stats.max_ms) {
+        stats.max_ms = ms;
+    }
+    stats.last_seen = num;
+    stats.learned_channels = learned;
+    ESP_LOGI(TAG, "%s scan took %lu ms, %u APs, kept %u", full ? "Full" : "Learned-channel",
+             (unsigned long)ms, num, (unsigned)count);
+    return count;
+}
+
+void wifi_scan_get_stats(wifi_scan_stats_t *stats_out) {
+    *stats_out = stats;
+}
@@ -0,0 +1,92 @@
+// Encode size and time of a telemetry batch (main/batch.c), JSON vs CBOR.
+//
+// Fills the batch queue with typical records, half of them with a location,
+// and encodes it in both wire formats for a few batch sizes. Replaces the
+// old BATCH_BENCHMARK boot log.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "batch.h"
+#include "tlog.h"
+
+#define BENCH_ROUNDS 20000
+
+int64_t esp_timer_get_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// No flash log on the host; the benchmark never overfills the queue
+esp_err_t tlog_append(const batch_record_t *record) {
+    (void)record;
+    return ESP_FAIL;
+}
+
+static void fill(int num_records) {
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < num_records; i++) {
+        batch_record_t record = {
+            .timestamp_us = now - (int64_t)(num_records - i) * 5000000,
+            .fall_events = i % 4 == 0,
+            .overtemp_events = i % 3,
+            .overhum_events = i % 2,
+            .has_location = i % 2 == 0,
+            .longitude = -79.942510,
+            .latitude = 40.443322,
+        };
+        batch_add(&record);
+    }
+}
+
+static double now_s(void) {
+    return esp_timer_get_time() / 1e6;
+}
+
+int main(void) {
+    static uint8_t buf[BATCH_BUFFER_SIZE];
+    const int sizes[] = { 1, 4, BATCH_MAX_RECORDS };
+    int failed = 0;
+
+    printf("%7s  %10s %10s  %10s %10s  %6s\n", "records", "JSON bytes", "JSON ns", "CBOR bytes", "CBOR ns", "ratio");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int n = sizes[s];
+        fill(n);
+
+        size_t json_len = 0;
+        double start = now_s();
+        for (int i = 0; i < BENCH_ROUNDS; i++) {
+            json_len = batch_encode_json((char *)buf, sizeof(buf));
+        }
+        double json_ns = (now_s() - start) * 1e9 / BENCH_ROUNDS;
+        if (json_len == 0 || buf[0] != '{' || memcmp(buf + json_len - 2, "]}", 2) != 0) {
+            failed = 1;
+        }
+
+        size_t cbor_len = 0;
+        start = now_s();
+        for (int i = 0; i < BENCH_ROUNDS; i++) {
+            cbor_len = batch_encode_cbor(buf, sizeof(buf));
+        }
+        double cbor_ns = (now_s() - start) * 1e9 / BENCH_ROUNDS;
+        // Map header, then the break that closes the events array
+        if (cbor_len == 0 || buf[0] != 0xa2 || buf[cbor_len - 1] != 0xff) {
+            failed = 1;
+        }
+
+        printf("%7d  %10zu %10.0f  %10zu %10.0f  %5.0f%%\n", n, json_len, json_ns, cbor_len, cbor_ns,
+               100.0 * cbor_len / json_len);
+
+        // Every record fits, so the commit empties the queue for the next size
+        batch_commit(cbor_len);
+        if (batch_count() != 0) {
+            failed = 1;
+        }
+    }
+
+    if (failed) {
+        printf("FAIL\n");
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
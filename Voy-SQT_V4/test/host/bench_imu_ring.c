@@ -0,0 +1,97 @@
+// Throughput benchmark for the lock-free IMU ring (main/imu_ring.c).
+//
+// Reports the cost of a push on its own, of a push plus an in-order read on
+// one thread, and the rate a reader on another thread sustains against a
+// producer running flat out, with the fraction of samples it lost to laps.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "imu_ring.h"
+
+#define BENCH_PUSHES    50000000u
+#define BENCH_CHUNK     64
+
+static imu_sample_t storage[IMU_RING_CAPACITY];
+static imu_ring_t ring;
+static atomic_bool producer_done;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *what, uint64_t samples, double seconds) {
+    printf("%-28s %6.2f ns/sample  %7.1f M samples/s\n", what, seconds * 1e9 / samples, samples / seconds / 1e6);
+}
+
+static void *producer(void *arg) {
+    (void)arg;
+    imu_sample_t s = { 0 };
+    for (uint32_t i = 0; i < BENCH_PUSHES; i++) {
+        s.timestamp_us = i;
+        imu_ring_push(&ring, &s);
+    }
+    atomic_store(&producer_done, true);
+    return NULL;
+}
+
+int main(void) {
+    imu_sample_t out[BENCH_CHUNK];
+    imu_sample_t s = { 0 };
+    volatile uint32_t sink = 0;
+
+    // Producer only
+    imu_ring_init(&ring, storage, IMU_RING_CAPACITY);
+    double start = now_s();
+    for (uint32_t i = 0; i < BENCH_PUSHES; i++) {
+        s.timestamp_us = i;
+        imu_ring_push(&ring, &s);
+    }
+    report("push", BENCH_PUSHES, now_s() - start);
+
+    // Push a chunk, read it back, on one thread
+    imu_ring_reader_t reader;
+    imu_ring_init(&ring, storage, IMU_RING_CAPACITY);
+    imu_ring_reader_init(&ring, &reader);
+    start = now_s();
+    for (uint32_t i = 0; i < BENCH_PUSHES; i += BENCH_CHUNK) {
+        for (uint32_t j = 0; j < BENCH_CHUNK; j++) {
+            s.timestamp_us = i + j;
+            imu_ring_push(&ring, &s);
+        }
+        sink += (uint32_t)imu_ring_read(&ring, &reader, out, BENCH_CHUNK);
+    }
+    report("push + read, one thread", BENCH_PUSHES, now_s() - start);
+
+    // Producer and reader on separate threads
+    imu_ring_init(&ring, storage, IMU_RING_CAPACITY);
+    imu_ring_reader_init(&ring, &reader);
+    atomic_store(&producer_done, false);
+    uint64_t returned = 0;
+    pthread_t prod;
+    start = now_s();
+    pthread_create(&prod, NULL, producer, NULL);
+    while (true) {
+        bool done = atomic_load(&producer_done);
+        size_t n = imu_ring_read(&ring, &reader, out, BENCH_CHUNK);
+        returned += n;
+        if (n == 0 && done) {
+            break;
+        }
+    }
+    double elapsed = now_s() - start;
+    pthread_join(prod, NULL);
+    if (sysconf(_SC_NPROCESSORS_ONLN) < 2) {
+        printf("single CPU host, producer and reader time-slice, the next two lines are not meaningful\n");
+    }
+    report("read, producer on a thread", returned, elapsed);
+    printf("%-28s %6.2f %% of %lu samples\n", "lost to laps", 100.0 * reader.dropped / BENCH_PUSHES,
+           (unsigned long)BENCH_PUSHES);
+
+    (void)sink;
+    return returned + reader.dropped == BENCH_PUSHES ? EXIT_SUCCESS : EXIT_FAILURE;
+}
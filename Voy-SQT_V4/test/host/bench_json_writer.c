@@ -0,0 +1,166 @@
+// Geolocation request body built with the streaming json_writer
+// (main/json_writer.c) vs the cJSON tree it replaced.
+//
+// Both paths build the same considerIp/wifiAccessPoints document for
+// MAX_APS access points. malloc, calloc, realloc and free are wrapped at link
+// time (-Wl,--wrap), so every heap call made by either path is counted.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "json_writer.h"
+#include "cJSON.h"
+
+#define MAX_APS             8
+#define WIFI_SCAN_JSON_MAX  (MAX_APS * 96 + 48)
+#define BENCH_ROUNDS        20000
+
+// Same layout as wifi_ap_t in geolocation.h, which needs ESP-IDF headers
+typedef struct {
+    char mac[18];
+    int signal_strength;
+    int signal_to_noise_ratio;
+} wifi_ap_t;
+
+typedef struct {
+    unsigned long calls;
+    unsigned long bytes;
+    unsigned long frees;
+} heap_count_t;
+
+static heap_count_t heap;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size) {
+    heap.calls++;
+    heap.bytes += size;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    heap.calls++;
+    heap.bytes += n * size;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    heap.calls++;
+    heap.bytes += size;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr) {
+    if (ptr) {
+        heap.frees++;
+    }
+    __real_free(ptr);
+}
+
+// generate_wifi_scan_json() in main/geolocation.c
+static size_t build_with_writer(const wifi_ap_t *wifi_aps, size_t num_aps, char *buf, size_t buf_len) {
+    json_writer_t w;
+    json_writer_init(&w, buf, buf_len);
+
+    json_begin_object(&w);
+    json_key(&w, "considerIp");
+    json_string(&w, "false");
+    json_key(&w, "wifiAccessPoints");
+    json_begin_array(&w);
+    for (size_t i = 0; i < num_aps; i++) {
+        json_begin_object(&w);
+        json_key(&w, "macAddress");
+        json_string(&w, wifi_aps[i].mac);
+        json_key(&w, "signalStrength");
+        json_int(&w, wifi_aps[i].signal_strength);
+        json_key(&w, "signalToNoiseRatio");
+        json_int(&w, wifi_aps[i].signal_to_noise_ratio);
+        json_end_object(&w);
+    }
+    json_end_array(&w);
+    json_end_object(&w);
+
+    return json_writer_finish(&w);
+}
+
+// The cJSON version it replaced, copied into buf so both paths hand the
+// caller the same thing
+static size_t build_with_cjson(const wifi_ap_t *wifi_aps, size_t num_aps, char *buf, size_t buf_len) {
+    cJSON *root = cJSON_CreateObject();
+    if (!root) {
+        return 0;
+    }
+    cJSON_AddStringToObject(root, "considerIp", "false");
+    cJSON *ap_array = cJSON_CreateArray();
+    cJSON_AddItemToObject(root, "wifiAccessPoints", ap_array);
+    for (size_t i = 0; i < num_aps; i++) {
+        cJSON *ap_obj = cJSON_CreateObject();
+        cJSON_AddStringToObject(ap_obj, "macAddress", wifi_aps[i].mac);
+        cJSON_AddNumberToObject(ap_obj, "signalStrength", wifi_aps[i].signal_strength);
+        cJSON_AddNumberToObject(ap_obj, "signalToNoiseRatio", wifi_aps[i].signal_to_noise_ratio);
+        cJSON_AddItemToArray(ap_array, ap_obj);
+    }
+
+    char *json_str = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json_str) {
+        return 0;
+    }
+    size_t len = strlen(json_str);
+    if (len >= buf_len) {
+        len = 0;
+    } else {
+        memcpy(buf, json_str, len + 1);
+    }
+    cJSON_free(json_str);
+    return len;
+}
+
+typedef size_t (*build_fn_t)(const wifi_ap_t *wifi_aps, size_t num_aps, char *buf, size_t buf_len);
+
+static void run(const char *name, build_fn_t build, const wifi_ap_t *aps, char *buf) {
+    struct timespec start, end;
+    size_t len = 0;
+
+    memset(&heap, 0, sizeof(heap));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        len = build(aps, MAX_APS, buf, WIFI_SCAN_JSON_MAX);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / BENCH_ROUNDS;
+    printf("%-12s %4zu bytes  %8.0f ns  %6.1f allocs  %7.0f heap bytes  %6.1f frees per document\n", name, len, ns,
+           (double)heap.calls / BENCH_ROUNDS, (double)heap.bytes / BENCH_ROUNDS, (double)heap.frees / BENCH_ROUNDS);
+}
+
+int main(void) {
+    wifi_ap_t aps[MAX_APS];
+    static char writer_buf[WIFI_SCAN_JSON_MAX];
+    static char cjson_buf[WIFI_SCAN_JSON_MAX];
+
+    for (int i = 0; i < MAX_APS; i++) {
+        snprintf(aps[i].mac, sizeof(aps[i].mac), "a4:%02x:b1:c2:d3:%02x", i * 31, 0xe0 + i);
+        aps[i].signal_strength = -48 - 6 * i;
+        aps[i].signal_to_noise_ratio = 0;
+    }
+
+    run("json_writer", build_with_writer, aps, writer_buf);
+    run("cJSON", build_with_cjson, aps, cjson_buf);
+
+    // Same bytes on the wire, and the writer never touches the heap
+    memset(&heap, 0, sizeof(heap));
+    build_with_writer(aps, MAX_APS, writer_buf, sizeof(writer_buf));
+    bool writer_heap_free = heap.calls == 0;
+    bool same = strcmp(writer_buf, cjson_buf) == 0;
+    if (!same) {
+        printf("documents differ:\n  %s\n  %s\n", writer_buf, cjson_buf);
+    }
+    if (!writer_heap_free) {
+        printf("json_writer allocated\n");
+    }
+    return same && writer_heap_free ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,9 @@
+// Host stand-in for the ESP-IDF header, the test program provides the clock
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
+
+#endif // ESP_TIMER_H
@@ -0,0 +1,80 @@
+// Concurrency test for the atomic telemetry counters (main/telemetry.c).
+//
+// Several writer threads increment every counter while a reader thread keeps
+// draining them with telemetry_take(). Once the writers finish, the amounts
+// the reader took plus what is left must equal the number of increments
+// exactly: the read-and-reset may not lose or double count an event.
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include "telemetry.h"
+
+#define NUM_WRITERS         4
+#define INCREMENTS_EACH     2000000u
+
+static atomic_bool writers_done;
+
+static void *writer(void *arg) {
+    (void)arg;
+    for (uint32_t i = 0; i < INCREMENTS_EACH; i++) {
+        for (int c = 0; c < TELEMETRY_NUM_COUNTERS; c++) {
+            telemetry_increment((telemetry_counter_t)c);
+        }
+        if ((i & 0x3fff) == 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void *reader(void *arg) {
+    uint64_t *taken = arg;
+    uint64_t takes = 0;
+    while (!atomic_load(&writers_done)) {
+        for (int c = 0; c < TELEMETRY_NUM_COUNTERS; c++) {
+            taken[c] += telemetry_take((telemetry_counter_t)c);
+        }
+        if ((++takes & 0xff) == 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+int main(void) {
+    pthread_t writers[NUM_WRITERS];
+    pthread_t reader_thread;
+    uint64_t taken[TELEMETRY_NUM_COUNTERS] = { 0 };
+    int failed = 0;
+
+    pthread_create(&reader_thread, NULL, reader, taken);
+    for (int i = 0; i < NUM_WRITERS; i++) {
+        pthread_create(&writers[i], NULL, writer, NULL);
+    }
+    for (int i = 0; i < NUM_WRITERS; i++) {
+        pthread_join(writers[i], NULL);
+    }
+    atomic_store(&writers_done, true);
+    pthread_join(reader_thread, NULL);
+
+    const uint64_t expected = (uint64_t)NUM_WRITERS * INCREMENTS_EACH;
+    for (int c = 0; c < TELEMETRY_NUM_COUNTERS; c++) {
+        uint64_t during = taken[c];
+        uint64_t total = during + telemetry_take((telemetry_counter_t)c);
+        printf("counter %d: %llu taken while writing, %llu total, expected %llu\n", c,
+               (unsigned long long)during, (unsigned long long)total, (unsigned long long)expected);
+        if (total != expected) {
+            failed = 1;
+        }
+        if (telemetry_peek((telemetry_counter_t)c) != 0) {
+            printf("counter %d: not zero after take\n", c);
+            failed = 1;
+        }
+    }
+
+    printf("%s\n", failed ? "FAIL" : "PASS");
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}